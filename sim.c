@@ -1,18 +1,43 @@
+#define _GNU_SOURCE // sched_setaffinity() e CPU_SET() no Linux
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h> // fork(), pipe(), read(), write(), close()
 #include <signal.h> // signal(), kill()
 #include <sys/wait.h> // waitpid()
-#include <time.h> //  time()
-#include <string.h> // strcpy()
+#include <time.h> //  time(), clock_gettime()
+#include <string.h> // strcmp(), memset()
+#include <math.h> // log() (tempos de serviço exponenciais)
 #include <errno.h> //  (errno), EAGAIN(erro de recurso não disponível em leitura não bloqueante), EWOULDBLOCK (erro similar)
 #include <fcntl.h> // fcntl(), F_GETFL, F_SETFL, O_NONBLOCK (para pipes não bloqueantes)
 #include <sys/select.h> // select()
+#include <getopt.h> // getopt_long()
+#ifdef __linux__
+#include <sys/epoll.h> // epoll_create1(), epoll_ctl(), epoll_wait()
+#include <sys/signalfd.h> // signalfd()
+#include <sys/timerfd.h> // timerfd_create(), timerfd_settime()
+#include <sys/eventfd.h> // eventfd() (campainha do transporte por memória compartilhada)
+#include <sys/syscall.h> // syscall(SYS_futex)
+#include <linux/futex.h> // FUTEX_WAIT, FUTEX_WAKE
+#endif
+#include <stdint.h> // uint64_t (bitmaps da tabela de processos, contador de expirações do timerfd)
+#include <sys/mman.h> // mmap()
+#include <sys/stat.h> // fstat() (tamanho do workload)
+#include <sched.h> // sched_yield()
+#include <stdatomic.h> // operações atômicas no anel compartilhado
+#include <pthread.h> // thread escritora do trace
+#include <ucontext.h> // makecontext(), swapcontext() (apps como fibras)
+#include <sys/resource.h> // getrusage() (memória máxima das fibras)
+#include "trace.h" // formato do trace binário (--trace)
+#include "stats.h" // página de estatísticas ao vivo (--stats)
 
 
 // Configurações
-#define NUM_PROCS_APP 5 
+#define NUM_PROCS_APP 5 // valor padrão; pode ser alterado com -n
 #define MAX_ITERATIONS 20 // máximo de iterações por App antes de terminar
+#ifndef APP_STEP_MS
+#define APP_STEP_MS 1000 // CPU gasta por iteração do app (o sleep(1) do modo real); os testes do modo real usam menos
+#endif
+#define OPEN_WINDOW_S 600 // sistema aberto: duração padrão das chegadas (-d)
 #define TIMESLICE_MS 500 // em milissegundos
 #define true 1
 #define false 0
@@ -30,16 +55,17 @@ typedef enum {
 } InterruptType;
 
 typedef enum {
-    READY,
-    RUNNING,
-    BLOCKED,
-    TERMINATED
+    READY = STATS_READY, // a numeração é a da página de estatísticas (stats.h)
+    RUNNING = STATS_RUNNING,
+    BLOCKED = STATS_BLOCKED,
+    TERMINATED = STATS_TERMINATED
 } ProcessState;
 
 typedef enum { 
     DEVICE_D1 = 0, 
     DEVICE_D2 = 1 
-} Device;
+} Device; // com -D os dispositivos são D1..Dn (índices 0..n-1)
+#define MAX_DEVICES 8
 typedef enum { 
     OP_READ = 0, 
     OP_WRITE = 1, 
@@ -50,6 +76,7 @@ typedef enum {
 // Mensagens InterController -> Kernel e Apps -> Kernel
 typedef struct {
     int type; // qual foi o InterruptType enviado pelo InterController
+    int cpu; // CPU de destino da IRQ0 (as de dispositivo não têm CPU)
 } IRQMsg;
 
 typedef enum { 
@@ -68,11 +95,38 @@ typedef struct {
 
 
 // PCBs e Tabelas
+// A tabela de processos é uma estrutura de arrays: pid, estado, PC e CPU ficam em vetores próprios
+// e o estado da política num vetor compacto, para que varreduras e despachos percorram só os campos
+// quentes; nome, contadores e métricas (frios) ficam num vetor separado.
+
+// Estado do app usado pelas políticas de escalonamento a cada tick e despacho
+typedef struct {
+    // tempo de CPU (para as políticas que contabilizam execução)
+    long long cpu_ns; // CPU consumida até a última contabilização
+    long long run_start; // quando recebeu a CPU (ou foi contabilizado) pela última vez
+
+    int level; // nível na MLFQ (0 = mais prioritário)
+    int ticks_used; // ticks consumidos no nível atual da MLFQ
+    long enq_tick; // tick em que entrou na fila da MLFQ (envelhecimento)
+    int tickets; // bilhetes (loteria e stride)
+    long long pass; // passo acumulado (stride)
+    long long vr_bias; // ajuste do vruntime na volta de um bloqueio (CFS); vruntime = cpu_ns + vr_bias
+    int static_prio; // prioridade estática (o1): 0 = mais prioritária; PRIO_DEFAULT + nice
+    int bonus; // ajuste dinâmico da prioridade (o1): negativo = bônus de E/S, positivo = penalidade de CPU
+    int expired; // o1: gastou o timeslice; a próxima entrada na fila vai para o vetor de expirados
+    int pinned; // afinidade: só executa na CPU de origem (não pode ser roubado)
+
+    // quantum adaptativo (-A)
+    int quantum; // ticks que o app pode executar neste despacho
+    int q_used; // ticks já consumidos deste quantum
+    long long burst_mark; // cpu_ns no último bloqueio (início do surto de CPU atual)
+    long long burst_ewma; // média móvel dos surtos de CPU entre bloqueios
+    int block_ewma; // média móvel da fração de quanta que terminaram em bloqueio (ADAPT_ONE = todos)
+} SchedState;
+
+// Dados frios: só lidos na tabela de status, nas métricas e nas transições de bloqueio
 typedef struct {
-    pid_t pid;
-    char name[3]; // nome do processo
-    ProcessState state;
-    int pc; // program counter do processo 
+    char name[16]; // nome do processo (A1, A2, ...)
 
     // bloqueio
     int blocked_dev; // -1 se não bloqueado
@@ -82,23 +136,54 @@ typedef struct {
     int count_read;
     int count_write;
     int count_exec;
+    int count_dev[MAX_DEVICES]; // syscalls em cada dispositivo
+
+    int host_cpu; // CPU real em que o app está fixado (-1 = nenhuma ainda)
+
+    // métricas de tempo (relógio monotônico no modo real, virtual no modo de eventos discretos)
+    long long arrival_ns; // quando ficou pronto pela primeira vez
+    long long first_run_ns; // primeiro despacho (-1 se ainda não executou)
+    long long finish_ns; // término
+    long long ready_since; // entrou no estado READY
+    long long blocked_since; // entrou no estado BLOCKED
+    long long wait_ns; // tempo total na fila de prontos
+    long long blocked_ns[MAX_DEVICES]; // tempo total bloqueado em cada dispositivo
+} ProcStats;
+
+#define NUM_STATES (TERMINATED + 1)
 
-    int alive; // se o filho ainda existe (não reaproveitado)
+typedef struct {
+    pid_t *pid;
+    ProcessState *state;
+    int *pc; // program counter do processo
+    int *cpu; // CPU simulada em que executou ou está enfileirado por último
+    SchedState *sched;
+    ProcStats *stats;
 
-    int count_d1;
-    int count_d2;
-} PCB;
+    // um bit por app: em cada estado e vivo (filho ainda existe, não reaproveitado)
+    uint64_t *state_bits[NUM_STATES];
+    uint64_t *alive;
+    int words; // palavras de 64 bits de cada bitmap
+    int count[NUM_STATES]; // apps em cada estado
+} ProcTable;
 
 // Filas para gerenciamento de PIDS
-#define QMAX 5 // tamanho máximo das filas de PIDs  
+#define QMAX 8 // capacidade inicial das filas de PIDs (potência de 2); as filas crescem sob demanda
 
 typedef struct {
-    pid_t data[QMAX];
+    pid_t *data;
     int head, tail, size;
+    int cap; // capacidade atual do buffer circular (sempre potência de 2)
 } PIDQueue; //struct da fila de PIDs
 
 void q_init(PIDQueue *q){ 
     q->head = q->tail = q->size = 0; 
+    q->cap = QMAX;
+    q->data = malloc(QMAX * sizeof(pid_t));
+    if(q->data == NULL){
+        printf("Erro na alocação das filas\n");
+        exit(1);
+    }
 }
 int q_empty(PIDQueue *q){ 
     if (q->size == 0) 
@@ -106,42 +191,356 @@ int q_empty(PIDQueue *q){
     return false;
 }
 int q_full (PIDQueue *q){ 
-    if (q->size == QMAX) 
+    if (q->size == q->cap) 
         return true;
     return false;
 }
+// Dobra a capacidade da fila, desenrolando o buffer circular para começar em 0
+int q_grow(PIDQueue *q){
+    int ncap = q->cap * 2;
+    pid_t *nd = malloc(ncap * sizeof(pid_t));
+    if(nd == NULL)
+        return false;
+    for(int i=0;i<q->size;i++)
+        nd[i] = q->data[(q->head + i) & (q->cap - 1)];
+    free(q->data);
+    q->data = nd;
+    q->cap = ncap;
+    q->head = 0;
+    q->tail = q->size;
+    return true;
+}
 int q_push (PIDQueue *q, pid_t v){
-    if(q_full(q)) 
-        return false; // não consegue enfileirar porque já esta cheio
+    if(q_full(q) && !q_grow(q)){ // sem memória para crescer: perder o PID deixaria o app fora de todas as filas
+        printf("Erro na alocação das filas\n");
+        exit(1);
+    }
     q->data[q->tail] = v; // coloca o pid depois do último atual
-    q->tail = (q->tail + 1) % QMAX; // atualiza o tail circularmente
+    q->tail = (q->tail + 1) & (q->cap - 1); // atualiza o tail circularmente
     q->size++; // aumenta o tamanho
     return true; // retorna true por ter conseguido enfileirar
 }
+int q_front(PIDQueue *q){ // retorna o pid do início sem retirar, ou -1 se vazia
+    if(q_empty(q))
+        return -1;
+    return q->data[q->head];
+}
 int q_pop(PIDQueue *q){ // a função retorna o pid que ela retirou 
     if(q_empty(q)) 
         return -1; // não consegue desenfileirar porque já esta vazio
     pid_t v = q->data[q->head];
-    q->head = (q->head + 1) % QMAX; // atualiza o head circularmente
+    q->head = (q->head + 1) & (q->cap - 1); // atualiza o head circularmente
     q->size--;
     return v; // retorna o pid que foi retirado
 }
+int q_remove(PIDQueue *q, pid_t v){ // retira v do meio da fila, mantendo a ordem dos demais; false se não estava
+    int i = 0;
+    while(i < q->size && q->data[(q->head + i) & (q->cap - 1)] != v)
+        i++;
+    if(i == q->size)
+        return false;
+    for(;i<q->size-1;i++)
+        q->data[(q->head + i) & (q->cap - 1)] = q->data[(q->head + i + 1) & (q->cap - 1)];
+    q->tail = (q->tail - 1) & (q->cap - 1);
+    q->size--;
+    return true;
+}
+void q_each(PIDQueue *q, void (*fn)(pid_t p)){ // visita os pids do início ao fim, sem retirar
+    for(int i=0;i<q->size;i++)
+        fn(q->data[(q->head + i) & (q->cap - 1)]);
+}
+
+// Mapa PID -> índice na tabela de PCBs (hash com endereçamento aberto e sondagem linear)
+typedef struct {
+    pid_t *keys; // 0 marca slot vazio
+    int *vals;
+    unsigned mask; // tamanho - 1 (tamanho é potência de 2)
+} PIDMap;
+
+static unsigned pid_hash(pid_t p){
+    return (unsigned)p * 2654435761u; // hash multiplicativo de Knuth
+}
+
+void pidmap_init(PIDMap *m, int n){
+    unsigned size = 16;
+    while(size < (unsigned)n * 2) // mantém o fator de carga <= 0.5
+        size <<= 1;
+    m->keys = calloc(size, sizeof(pid_t));
+    m->vals = malloc(size * sizeof(int));
+    if(m->keys == NULL || m->vals == NULL){
+        printf("Erro na alocação do mapa de PIDs\n");
+        exit(1);
+    }
+    m->mask = size - 1;
+}
+
+void pidmap_put(PIDMap *m, pid_t p, int idx){
+    unsigned h = pid_hash(p) & m->mask;
+    while(m->keys[h] != 0 && m->keys[h] != p)
+        h = (h + 1) & m->mask;
+    m->keys[h] = p;
+    m->vals[h] = idx;
+}
+
+int pidmap_get(PIDMap *m, pid_t p){
+    unsigned h = pid_hash(p) & m->mask;
+    while(m->keys[h] != 0){
+        if(m->keys[h] == p)
+            return m->vals[h];
+        h = (h + 1) & m->mask;
+    }
+    return -1;
+}
 
 // Variáveis globais
-PCB pcb[NUM_PROCS_APP]; // tabela de PCBs
-PIDQueue ready_q;
-PIDQueue blocked_d1_q;
-PIDQueue blocked_d2_q;
+int num_procs_app = NUM_PROCS_APP; // quantidade de apps (pode ser alterada por -n na linha de comando)
+// Parâmetros do modelo: os #defines são os padrões; a varredura (-W) muda por execução
+int max_iterations = MAX_ITERATIONS;
+int timeslice_ms = TIMESLICE_MS;
+int prob_syscall = PROB_SYSCALL;
+int p1_prob = P1_PROB;
+int p2_prob = P2_PROB;
+ProcTable pt; // tabela de processos (alocada em main com num_procs_app entradas)
+PIDMap pid_map; // PID -> índice na tabela de processos
+
+void proc_table_init(int n){
+    pt.pid = calloc(n, sizeof(pid_t));
+    pt.state = calloc(n, sizeof(ProcessState));
+    pt.pc = calloc(n, sizeof(int));
+    pt.cpu = calloc(n, sizeof(int));
+    pt.sched = calloc(n, sizeof(SchedState));
+    pt.stats = calloc(n, sizeof(ProcStats));
+    pt.words = (n + 63) / 64;
+    int ok = pt.pid && pt.state && pt.pc && pt.cpu && pt.sched && pt.stats;
+    for(int s=0;s<NUM_STATES;s++){
+        pt.state_bits[s] = calloc(pt.words, sizeof(uint64_t));
+        pt.count[s] = 0;
+        ok = ok && pt.state_bits[s];
+    }
+    pt.alive = calloc(pt.words, sizeof(uint64_t));
+    if(!ok || pt.alive == NULL){
+        printf("Erro na alocação da tabela de processos\n");
+        exit(1);
+    }
+    // calloc deixa state = READY (0): o bitmap de READY começa com todos os apps
+    for(int i=0;i<n;i++)
+        pt.state_bits[READY][i >> 6] |= 1ULL << (i & 63);
+    pt.count[READY] = n;
+}
+
+// Toda mudança de estado passa por aqui para manter os bitmaps e as contagens
+void proc_set_state(int i, ProcessState s){
+    uint64_t bit = 1ULL << (i & 63);
+    pt.state_bits[pt.state[i]][i >> 6] &= ~bit;
+    pt.count[pt.state[i]]--;
+    pt.state[i] = s;
+    pt.state_bits[s][i >> 6] |= bit;
+    pt.count[s]++;
+}
+
+void proc_set_alive(int i, int alive){
+    if(alive)
+        pt.alive[i >> 6] |= 1ULL << (i & 63);
+    else
+        pt.alive[i >> 6] &= ~(1ULL << (i & 63));
+}
+int proc_alive(int i){
+    return (pt.alive[i >> 6] >> (i & 63)) & 1;
+}
+
+// Próximo app com o bit ligado em bits a partir de i (inclusive); -1 se não há
+int bits_next(uint64_t *bits, int i){
+    int w = i >> 6;
+    if(w >= pt.words)
+        return -1;
+    uint64_t m = bits[w] & (~0ULL << (i & 63));
+    while(m == 0){
+        if(++w == pt.words)
+            return -1;
+        m = bits[w];
+    }
+    return (w << 6) + __builtin_ctzll(m);
+}
+
+int bits_count(uint64_t *bits){
+    int n = 0;
+    for(int w=0;w<pt.words;w++)
+        n += __builtin_popcountll(bits[w]);
+    return n;
+}
 
 int irq_pipe[2], sys_pipe[2]; // pipes de comunicação 
 
+// Log de eventos do kernel (desligado com -q; útil no modo de eventos discretos com muitos processos)
+int verbose = true;
+#define KLOG(...) do { if(verbose) printf(__VA_ARGS__); } while(0)
+
+// Motor de execução: processos reais (fork + sinais) ou simulação por eventos discretos em tempo virtual
+typedef enum {
+    ENGINE_REAL = 0,
+    ENGINE_DES = 1
+} Engine;
+Engine engine = ENGINE_REAL;
+int app_fibers = false; // -e fiber: eventos discretos com o código dos apps executando em fibras (ucontext)
+
+// Backend do loop principal do kernel
+typedef enum {
+    LOOP_SELECT = 0,
+    LOOP_EPOLL = 1
+} LoopBackend;
+LoopBackend loop_backend = LOOP_SELECT;
+
+// Origem das IRQs: processo InterController (pipe) ou timer dentro do próprio kernel
+typedef enum {
+    TIMER_IC = 0,
+    TIMER_TIMERFD = 1
+} TimerSource;
+TimerSource timer_source = TIMER_IC;
+int irq_fd = -1; // descritor que o loop do kernel monitora para IRQs (irq_pipe[0] ou o timerfd)
+unsigned long long sim_seed; // semente da simulação (-s); padrão time(NULL)
+
+// Gerador pseudoaleatório próprio (xorshift64*), para que uma semente reproduza a mesma sequência
+typedef struct {
+    unsigned long long s;
+} Rng;
+
+void rng_seed(Rng *r, unsigned long long seed){
+    r->s = seed * 0x9E3779B97F4A7C15ull + 0x632BE59BD9B4E019ull; // estado nunca pode ser 0
+    if(r->s == 0)
+        r->s = 1;
+}
+unsigned rng_next(Rng *r){
+    r->s ^= r->s >> 12;
+    r->s ^= r->s << 25;
+    r->s ^= r->s >> 27;
+    return (unsigned)((r->s * 0x2545F4914F6CDD1Dull) >> 32);
+}
+int rng_range(Rng *r, int n){ // inteiro em 0..n-1
+    return (int)(((unsigned long long)rng_next(r) * n) >> 32);
+}
+
+Rng kernel_rng; // RNG das IRQs de dispositivo geradas pelo kernel (modo timerfd)
+
+// Transporte das mensagens Apps -> Kernel: sys_pipe ou anel em memória compartilhada
+typedef enum {
+    TRANSPORT_PIPE = 0,
+    TRANSPORT_SHM = 1
+} Transport;
+Transport transport = TRANSPORT_PIPE;
+int sys_fd = -1; // descritor que o loop do kernel monitora para mensagens de apps (sys_pipe[0] ou o eventfd)
+
+// Anel MPSC sem locks (fila limitada de Vyukov) num mmap MAP_SHARED criado antes dos forks.
+// Cada slot tem um número de sequência: o produtor só escreve quando seq == posição e publica com
+// seq = posição + 1; o kernel (único consumidor) só lê quando seq == posição + 1.
+typedef struct {
+    atomic_uint seq;
+    AppMsg msg;
+} RingSlot;
+
+typedef struct {
+    _Alignas(64) atomic_uint tail; // próxima posição reservada pelos apps
+    _Alignas(64) unsigned head; // próxima posição lida pelo kernel
+    _Alignas(64) atomic_int sleeping; // kernel vai bloquear no select/epoll: apps tocam a campainha
+    unsigned mask; // capacidade - 1
+    RingSlot slots[];
+} ShmRing;
+
+ShmRing *shm_ring;
+int shm_doorbell = -1; // eventfd compartilhado com os apps
+
+// Suspensão dos apps: SIGSTOP/SIGCONT ou permissão de execução num futex compartilhado
+typedef enum {
+    SUSPEND_SIGNAL = 0,
+    SUSPEND_FUTEX = 1
+} SuspendMode;
+SuspendMode suspend_mode = SUSPEND_SIGNAL;
+
+// Permissão de execução de cada app (uma linha de cache cada, num mmap MAP_SHARED criado antes dos forks).
+// Só o kernel concede; o kernel revoga, e o app revoga a própria antes de uma syscall. O app confere a
+// permissão entre fatias de CPU e, sem ela, dorme no futex. Não há SIGSTOP atrasado que pare um app
+// já retomado: conceder depois de revogar sempre vence.
+#define PERMIT_REVOKED 0
+#define PERMIT_GRANTED 1
+#define PERMIT_PARKED 2 // revogada e o app dorme no futex: conceder precisa de FUTEX_WAKE
+#define RUN_CHUNK_MS 10 // fatia de CPU entre duas conferências da permissão
+
+typedef struct {
+    _Alignas(64) atomic_uint state;
+} RunPermit;
+
+RunPermit *permits;
+
+// Progresso dos apps: uma mensagem APP_PROGRESS por iteração ou o PC publicado num contador por app
+// (num mmap MAP_SHARED criado antes dos forks). No modo shm só syscalls e términos passam pelo
+// transporte; o kernel lê o contador quando precisa do PC (status, página de estatísticas, término).
+typedef enum {
+    PROGRESS_MSG = 0,
+    PROGRESS_SHM = 1
+} ProgressMode;
+ProgressMode progress_mode = PROGRESS_MSG;
+atomic_int *pc_slots; // PC de cada app (-P shm)
+long kernel_wakeups = 0; // voltas do loop do kernel com algo para tratar (modo real)
+long app_msgs = 0, progress_msgs = 0; // mensagens de apps recebidas pelo kernel (modo real)
+
+int permit_open(int nprocs){
+    permits = mmap(NULL, nprocs * sizeof(RunPermit), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(permits == MAP_FAILED)
+        return -1;
+    for(int i=0;i<nprocs;i++)
+        atomic_init(&permits[i].state, PERMIT_REVOKED);
+    return 0;
+}
+
+// Kernel: entrega a CPU ao app i (1 syscall só se ele já estiver dormindo no futex)
+void permit_grant(int i){
+    if(atomic_exchange(&permits[i].state, PERMIT_GRANTED) == PERMIT_PARKED){
+#ifdef __linux__
+        syscall(SYS_futex, &permits[i].state, FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+    }
+}
+
+// Kernel: retira a CPU do app i; ele para na próxima conferência (sem syscall)
+void permit_revoke(int i){
+    unsigned expected = PERMIT_GRANTED;
+    atomic_compare_exchange_strong(&permits[i].state, &expected, PERMIT_REVOKED);
+}
+
+// App: espera até ter a permissão
+void permit_wait(int i){
+    unsigned v = atomic_load(&permits[i].state);
+    while(v != PERMIT_GRANTED){
+        if(v == PERMIT_REVOKED && !atomic_compare_exchange_weak(&permits[i].state, &v, PERMIT_PARKED))
+            continue; // v foi atualizado pela CAS
+#ifdef __linux__
+        syscall(SYS_futex, &permits[i].state, FUTEX_WAIT, PERMIT_PARKED, NULL, NULL, 0);
+#endif
+        v = atomic_load(&permits[i].state);
+    }
+}
+
+// Cria os contadores de PC (-P shm)
+int pc_slots_open(int nprocs){
+    pc_slots = mmap(NULL, nprocs * sizeof(atomic_int), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(pc_slots == MAP_FAILED)
+        return -1;
+    for(int i=0;i<nprocs;i++)
+        atomic_init(&pc_slots[i], 0);
+    return 0;
+}
+
+// PC do app i; com -P shm é lido do contador do app só agora, quando alguém precisa dele
+int proc_pc(int i){
+    if(pc_slots)
+        pt.pc[i] = atomic_load_explicit(&pc_slots[i], memory_order_relaxed);
+    return pt.pc[i];
+}
+
 //Função que retorna o índice do PID na tabela de PCB, se não achar, retorna -1
 int app_index_from_pid(pid_t p){
-    for(int i=0;i<NUM_PROCS_APP;i++) {
-        if(pcb[i].pid == p) 
-            return i;
-    }
-    return -1;
+    if(p <= 0)
+        return -1;
+    return pidmap_get(&pid_map, p);
 }
 
 int got_sigint = 0; // flag para verificar se recebeu SIGINT por Ctrl+C
@@ -167,11 +566,13 @@ char* state_str(ProcessState s){
         case TERMINATED: 
             return "TERMINATED";
     }
+    return "?";
 }
 char* dev_str(int d){ 
-    if (d==0)
-        return "D1";
-    return "D2";
+    static char *names[] = { "D1", "D2", "D3", "D4", "D5", "D6", "D7", "D8" };
+    if(d >= 0 && d < MAX_DEVICES)
+        return names[d];
+    return "?";
 }
 
 char* op_str(int op){
@@ -183,6 +584,7 @@ char* op_str(int op){
         case OP_EXEC: 
             return "EXEC"; 
     }
+    return "?";
 }
 
 // Função para setar um pipe como não bloqueante 
@@ -191,415 +593,4250 @@ void set_nonblock(int fd){
     fcntl(fd, F_SETFL, flags | O_NONBLOCK); // adiciona a flag de não bloqueante
 }
 
-//Função para imprimir a tabela de status dos processos. é chamada quando a flag de sigint está como 1. 
-//A função fprintf é usada para imprimir no stderr,
-void print_status_table(){
-    printf("\n===== STATUS (Kernel PID = %d) =====\n", getpid());
-    printf(" PID     | Name |   State   |  PC  | Blocked | Op   | R  W  X |  D1ACS  |  D2ACS  | \n");
-    printf("--------------------------------------------------------------\n");
-    for(int i=0;i<NUM_PROCS_APP;i++){
-        PCB *p = &pcb[i];
-        printf(" %-7d | %-4s | %-9s | %-4d | ", p->pid, p->name, state_str(p->state), p->pc);
-        if(p->state == BLOCKED){
-            printf("%-7s | %-4s | ", dev_str(p->blocked_dev), op_str(p->blocked_op));
-        } else {
-            printf("%-7s | %-4s | ", "-", "-");
-        }
-        printf("%-2d %-2d %-2d    %2d          %2d\n", p->count_read, p->count_write, p->count_exec, p->count_d1, p->count_d2);
-    }
-    printf(" ReadyQ size=%d | D1Q=%d | D2Q=%d\n", ready_q.size, blocked_d1_q.size, blocked_d2_q.size);
-    printf("================================\n\n");
+// Relógio monotônico em nanossegundos
+long long mono_ns(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
 }
 
-// Função para trocar o processo em execução
-int current_pid = -1;
-
-// Enfileira o processo antigo (se aplicável) e troca para next_pid
-void switch_to(pid_t next_pid){
-    int nidx = app_index_from_pid(next_pid);
-    // Pare o atual e re-enfileire se ainda estiver RUNNING
-    if(current_pid > 0){
-        int idx = app_index_from_pid(current_pid);
+long long des_now = 0; // relógio virtual do motor de eventos discretos
 
-        if(idx >= 0 && pcb[idx].state == RUNNING){
-            //Para o processo atual, seta seu estado como READY e o enfileira novamente na fila de prontos
-            kill(current_pid, SIGSTOP);
-            pcb[idx].state = READY;
-            q_push(&ready_q, current_pid);
+// Tempo atual da simulação: relógio monotônico no modo real, relógio virtual no modo de eventos discretos
+long long now_ns(){
+    if(engine == ENGINE_DES)
+        return des_now;
+    return mono_ns();
+}
 
-            printf("[Kernel] Troca -> %s (fim do timeslice de %s)\n", pcb[nidx].name, pcb[idx].name);
-            
-        }
-    }
+// Jitter do timeslice: intervalo real entre duas IRQ0 tratadas pelo kernel menos timeslice_ms
+typedef struct {
+    long long first_ns, last_ns;
+    long n; // quantidade de intervalos medidos
+    long long sum, sum_abs; // em microssegundos
+    long long max_abs; // maior |jitter| em microssegundos
+} JitterStats;
+JitterStats jitter;
 
-    // Inicia/continua o próximo
-    if(nidx >= 0 && pcb[nidx].state == READY){
-        pcb[nidx].state = RUNNING;
-        current_pid = next_pid;
-        kill(next_pid, SIGCONT);
-        printf("[Kernel] Executando %s\n", pcb[nidx].name);
-       
-        
+void jitter_tick(){
+    long long t = now_ns();
+    if(jitter.last_ns != 0){
+        long long d = (t - jitter.last_ns) / 1000 - timeslice_ms * 1000LL;
+        jitter.n++;
+        jitter.sum += d;
+        jitter.sum_abs += llabs(d);
+        if(llabs(d) > jitter.max_abs)
+            jitter.max_abs = llabs(d);
+    } else {
+        jitter.first_ns = t;
     }
+    jitter.last_ns = t;
 }
 
-// InterController 
-void intercontroller_process(){
-    close(irq_pipe[0]); // fecha leitura
-    // Fechar sys_pipe no IC
-    close(sys_pipe[0]); close(sys_pipe[1]);
-
-    IRQMsg m; //Struct para envio de mensagens de IRQ
-    int r; // número aleatório
-    // semente aleatória para geração de números aleatórios
-    srand((unsigned)time(NULL));
-
-
-    while(1){
-        usleep(TIMESLICE_MS * 1000); // espera o tempo do timeslice
-        m.type = IRQ_TIMESLICE; // gera o timeslice
-        if(write(irq_pipe[1], &m, sizeof(m)) < 0){
-            // Kernel pode ter morrido; encerra
-            exit(0);
-        }
-
-        // Gera IRQ1/IRQ2 de acordo com a probabilidade
-        r = rand()%100;
-        if(r < P1_PROB){
-            m.type = IRQ_IO_D1;
-            write(irq_pipe[1], &m, sizeof(m));
-        }
-
-        r = rand()%100;
-        if(r < P2_PROB){
-            m.type = IRQ_IO_D2;
-            write(irq_pipe[1], &m, sizeof(m));
-        }
-
-    }
+void print_jitter(){
+    if(jitter.n == 0)
+        return;
+    // deriva acumulada: quanto o último IRQ0 se afastou do instante ideal first + n*quantum
+    long long drift = (jitter.last_ns - jitter.first_ns) / 1000 - jitter.n * timeslice_ms * 1000LL;
+    printf("[Kernel] Jitter do timeslice (%s): %ld quanta, média %.1f us, média |jitter| %.1f us, máx |jitter| %lld us, deriva acumulada %lld us\n",
+           timer_source == TIMER_TIMERFD ? "timerfd" : "InterController",
+           jitter.n, (double)jitter.sum / jitter.n, (double)jitter.sum_abs / jitter.n, jitter.max_abs, drift);
 }
 
-// --------------- App ---------------
-static void app_process(int app_no){
-    // app_no em 0..NUM_PROCS_APP-1
-    // Fechar descritores que não usa
-    close(irq_pipe[0]); close(irq_pipe[1]); // apps não usam IRQ pipe
-    close(sys_pipe[0]); // app só escreve
+// Quantas vezes o loop do kernel acordou e quantas mensagens de apps tratou (modo real)
+void print_loop_stats(){
+    printf("[Kernel] %ld despertares do loop | %ld mensagens de apps (%ld de progresso) | progresso por %s\n",
+           kernel_wakeups, app_msgs, progress_msgs, progress_mode == PROGRESS_SHM ? "contador compartilhado" : "mensagem");
+}
 
-    int r;
-    // semente aleatória por processo
-    srand(time(NULL)  ^  getpid());
+// --------------- Políticas de escalonamento ---------------
+#define DEFAULT_TICKETS 100 // bilhetes de cada app (loteria/stride)
+#define STRIDE1 (1 << 20) // constante do stride: passo = STRIDE1 / bilhetes
+#define MLFQ_LEVELS 3 // níveis da MLFQ; o nível k tem quantum de 2^k timeslices
+#define MLFQ_AGING_TICKS 20 // ticks esperando num nível inferior até subir um nível
+#define PRIO_LEVELS 40 // prioridades do o1 (nice -20..19 -> 0..39)
+#define PRIO_DEFAULT 20 // prioridade estática com nice 0
+#define PRIO_BONUS_MAX 5 // o ajuste dinâmico fica em -5..+5 níveis
+#define PRIO_IO_BOOST 2 // níveis ganhos ao voltar de um dispositivo
+#define MAX_CPUS 64 // limite de CPUs simuladas (-c)
+#define MAX_NICE 64 // valores em -N
+#define ADAPT_TICK_MS 50 // com -A o IRQ0 vira um tick fino e o quantum de cada app é um múltiplo dele
+#define ADAPT_QMIN_MS 100 // menor quantum adaptativo (limita a taxa de trocas)
+#define ADAPT_QMAX_MS 2000 // maior quantum adaptativo
+#define ADAPT_OVERHEAD_PCT 1 // o quantum mínimo também garante troca <= 1% do quantum (custo medido)
+#define ADAPT_DES_SWITCH_US 50 // custo de uma troca no tempo virtual: modelado, para as decisões não dependerem do host
+#define ADAPT_ONE 1024 // 1.0 em ponto fixo (fração de quanta terminados em bloqueio)
 
-    int pc = 0;
-    while(pc < MAX_ITERATIONS){
-        sleep(1); // 1 seg
+long sched_ticks = 0; // períodos de timeslice (IRQ0 da CPU 0) tratados pelo kernel
+long long adapt_target_ns = 0; // quantum adaptativo (-A): meta de tempo de resposta; 0 = quantum fixo
+long adapt_decisions = 0; // quanta escolhidos pelo controlador
+Rng sched_rng; // sorteios da loteria
 
-        // Chance de syscall
-        r = rand()%100;
-        if(r < PROB_SYSCALL){
-            // escolhe device/op
-            Device d;
-            if (rand() % 2 == 0)
-                d = DEVICE_D1;
-            
-            else
-                d = DEVICE_D2;
-            int opraw = rand()%3;
-            Operation op = (Operation)opraw;
-
-            AppMsg msg;
-            msg.device = (int)d;
-            msg.type = APP_SYSCALL;
-            msg.pid = getpid();
-            msg.op = (int)op; 
-            write(sys_pipe[1], &msg, sizeof(msg));
-
-            // Envia um sigstop para si mesmo. Kernel decidirá o que vai fazer
-            kill(getpid(), SIGSTOP);
-            
-        } else {
-            // avança PC
-            pc++;
-            AppMsg progress;
-            progress.type = APP_PROGRESS;
-            progress.pid = getpid();
-            progress.device = -1;
-            progress.op = pc;
-            write(sys_pipe[1], &progress, sizeof(progress));
-        }
-    }
-
-    // terminou
-    AppMsg done;
-    done.type = APP_TERMINATED;
-    done.pid = getpid();
-    done.device = -1;
-    done.op = -1;
-    write(sys_pipe[1], &done, sizeof(done));
-    exit(0);
+// Contabiliza a CPU usada por idx desde a última contabilização
+void charge_cpu(int idx){
+    long long t = now_ns();
+    pt.sched[idx].cpu_ns += t - pt.sched[idx].run_start;
+    pt.sched[idx].run_start = t;
 }
 
-// --------------- Kernel (Main) ---------------
-int main(void){
-    // Instala sinais para status/pause/retomar
-    signal(SIGINT,  sigint_handler);
-    signal(SIGUSR1, sigusr1_handler);
-    signal(SIGCONT, sigusr1_handler);
+// Heap binário de mínimo de (chave, índice), usado por stride e CFS
+typedef struct {
+    long long key;
+    int idx;
+} KeyItem;
 
-    if(pipe(irq_pipe) < 0 || pipe(sys_pipe) < 0){
-        printf("Erro na criação dos pipes\n");
-        exit(1);
-    }
+typedef struct {
+    KeyItem *it;
+    int size, cap;
+} KeyHeap;
 
-    
-    // Colocar leitura como não bloqueante dos pipes 
-    set_nonblock(irq_pipe[0]);
-    set_nonblock(sys_pipe[0]);
+static int key_less(KeyItem *a, KeyItem *b){
+    if(a->key != b->key)
+        return a->key < b->key;
+    return a->idx < b->idx; // desempate determinístico
+}
 
-    // Cria InterController
-    pid_t ic_pid = fork();
-    if(ic_pid < 0){ 
-        printf("Erro na criação do InterControllerSIM\n");
+void key_heap_init(KeyHeap *h){
+    h->cap = QMAX;
+    h->size = 0;
+    h->it = malloc(h->cap * sizeof(KeyItem));
+    if(h->it == NULL){
+        printf("Erro na alocação do heap de prontos\n");
         exit(1);
     }
-    if(ic_pid == 0){
-        intercontroller_process();
-        exit(0);
-    }
-
-    // Fecha escrita de IRQ no Kernel; quem escreve é só o IC
-    close(irq_pipe[1]);
-
-    // Cria as filas de pronto, bloqueado em D1 e bloqueado em D2
-    q_init(&ready_q);
-    q_init(&blocked_d1_q);
-    q_init(&blocked_d2_q);
-
-    //Criaçao dos processos
-    for(int i=0;i<NUM_PROCS_APP;i++){
-        char name[3], number_to_chr;
-        number_to_chr = (char)i + 49;
-        name[0] = 'A';
-        name[1] = number_to_chr;
-        name[2] = '\0';
-        strcpy(pcb[i].name, name);
-        pcb[i].state = READY;
-        pcb[i].pc = 0;
-        pcb[i].blocked_dev = -1;
-        pcb[i].blocked_op = -1;
-        pcb[i].count_read = pcb[i].count_write = pcb[i].count_exec = 0;
-        pcb[i].alive = false;
-        pcb[i].count_d1 = 0;
-        pcb[i].count_d2 = 0;
+}
 
-        pid_t p = fork();
-        if(p < 0){
-            printf("Erro na criação dos processos\n");
+void key_heap_push(KeyHeap *h, long long key, int idx){
+    if(h->size == h->cap){
+        h->cap *= 2;
+        h->it = realloc(h->it, h->cap * sizeof(KeyItem));
+        if(h->it == NULL){
+            printf("Erro na alocação do heap de prontos\n");
             exit(1);
         }
-        if(p == 0){
-            // Os application processes começam parados, e são escalonados quando o kernel decidir
-            // Para isso: mandar SIGSTOP a si mesmo, Kernel fará SIGCONT quando escalar
-            kill(getpid(), SIGSTOP);
-            app_process(i);
-            return 0;
-        }
-        // No Kernel: registra PCB e enfileira
-        pcb[i].pid = p;
-        pcb[i].alive = true;
-        q_push(&ready_q, p);
-        printf("[Kernel] %s PID=%d pronto\n", pcb[i].name, p);
-        
     }
-
-    // Kernel não escreve no sys_pipe; só lê
-    close(sys_pipe[1]);
-
-    // Começa executando o primeiro pronto
-    if(!q_empty(&ready_q)){
-        pid_t first = q_pop(&ready_q);
-        int fidx = app_index_from_pid(first);
-        if(fidx >= 0) pcb[fidx].state = READY;
-        switch_to(first);
+    KeyItem e = { key, idx };
+    int i = h->size++;
+    while(i > 0 && key_less(&e, &h->it[(i - 1) / 2])){
+        h->it[i] = h->it[(i - 1) / 2];
+        i = (i - 1) / 2;
     }
+    h->it[i] = e;
+}
 
-    // Loop principal do Kernel
-    int apps_terminated = 0;
-    fd_set rds; // estrutura usada por select() para indicarmos quais file descriptors (pipes) queremos monitorar 
-    int nfds = (irq_pipe[0] > sys_pipe[0] ? irq_pipe[0] : sys_pipe[0]) + 1; // define o maior numero de descritor que queremos avaliar + 1
-
+KeyItem key_heap_pop(KeyHeap *h){
+    KeyItem top = h->it[0];
+    KeyItem last = h->it[--h->size];
+    int i = 0;
     while(1){
-        if(apps_terminated >= NUM_PROCS_APP){
-            printf("[Kernel] Todos os apps terminaram.\n");
-            // Encerra IC e sai
-            kill(ic_pid, SIGKILL);
-            waitpid(ic_pid, NULL, 0);
+        int c = 2 * i + 1;
+        if(c >= h->size)
             break;
-        }
+        if(c + 1 < h->size && key_less(&h->it[c + 1], &h->it[c]))
+            c++;
+        if(!key_less(&h->it[c], &last))
+            break;
+        h->it[i] = h->it[c];
+        i = c;
+    }
+    if(h->size > 0)
+        h->it[i] = last;
+    return top;
+}
 
-        if(got_sigint){
-            got_sigint = 0;
-            print_status_table();
-            pause();
-        }
+// Retira idx de qualquer posição do heap; false se não estava
+int key_heap_remove(KeyHeap *h, int idx){
+    int i = 0;
+    while(i < h->size && h->it[i].idx != idx)
+        i++;
+    if(i == h->size)
+        return false;
+    KeyItem last = h->it[--h->size];
+    if(i == h->size)
+        return true;
+    while(i > 0 && key_less(&last, &h->it[(i - 1) / 2])){ // sobe
+        h->it[i] = h->it[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    while(1){ // ou desce
+        int c = 2 * i + 1;
+        if(c >= h->size)
+            break;
+        if(c + 1 < h->size && key_less(&h->it[c + 1], &h->it[c]))
+            c++;
+        if(!key_less(&h->it[c], &last))
+            break;
+        h->it[i] = h->it[c];
+        i = c;
+    }
+    h->it[i] = last;
+    return true;
+}
 
-        FD_ZERO(&rds); 
-        FD_SET(irq_pipe[0], &rds); // coloca os pipes dentro da estrutura de seleção
-        FD_SET(sys_pipe[0], &rds);
+// CPU simulada: processo atual, estrutura de prontos local (a da política escolhida) e estatísticas
+typedef struct {
+    pid_t current_pid; // app executando nesta CPU (-1 = ociosa)
+    int need_resched; // algum evento do lote atual pede nova decisão de escalonamento nesta CPU
 
-        // Espera algo chegar (IRQ0/1/2 ou SYSCALL/TERM)
-        int rv = select(nfds, &rds, NULL, NULL, NULL); // o select ordena o kernel a esperar até que possua alguma mensagem em algum dos pipes definidos com FD_SET para ler. enquanto isso, o kernel "dorme"
-        if(rv < 0){ // se o tempo de espera acabou e nada ficou pronto
-            if(errno == EINTR) // se ele foi interrompido por um sinal (como Ctrl+C, apenas passa a próxima iteração do loop)
-                continue;
-            printf("Erro na leitura dos pipes\n");
-            break;
-        }
+    PIDQueue rq; // rr
+    PIDQueue mlfq_q[MLFQ_LEVELS]; // mlfq
+    unsigned mlfq_mask;
+    int mlfq_count;
+    long long *lot_tree; // loteria
+    uint64_t *lot_bits; // loteria: apps com bilhetes na árvore, um bit por app
+    long long lot_total;
+    int lot_count;
+    KeyHeap heap; // stride e cfs
+    long long heap_floor; // stride: passo global; cfs: min_vruntime
+    PIDQueue prio_q[2][PRIO_LEVELS]; // o1: vetores ativo e expirado, uma fila FIFO por prioridade
+    uint64_t prio_mask[2]; // o1: prioridades não vazias de cada vetor
+    int prio_active; // o1: qual dos dois vetores é o ativo
+    int prio_count;
+    int movable; // prontos não fixados (-a): a vítima do roubo é a CPU com mais deles
 
-        // 1) Mensagens de Apps (syscalls / terminated)
-        if(FD_ISSET(sys_pipe[0], &rds)){ // verifica se alguma mensagem no pipe de syscall foi enviada
-            while (1){
-                AppMsg am;
-                int n = read(sys_pipe[0], &am, sizeof(am));
-                if(n < 0){
-                    if(errno==EAGAIN || errno==EWOULDBLOCK) // se o read falhou pq nao tem mais nada pra ler(pipe vazio), volta pro loop principal do kernel
-                        break;
-                    printf("Erro na leitura do pipe de syscall\n"); // aqui, é necessário que a estrutura e funcionamento do pipe esteja quebrada
-                    break;
-                }
-                if(n == 0) // se o escritor fechou, volta para o loop principal.
-                    break;
+    long ticks, idle_ticks, dispatches, steals;
+} Cpu;
 
-                if(am.type == APP_SYSCALL){ // se for syscall
-                    int idx = app_index_from_pid(am.pid);
-                    if(idx >= 0 && pcb[idx].state != TERMINATED){
-                        // marca bloqueado e contabiliza
-                        pcb[idx].state = BLOCKED;
-                        pcb[idx].blocked_dev = am.device;
-                        pcb[idx].blocked_op  = am.op;
-                        if(am.op == OP_READ) 
-                            pcb[idx].count_read++;
-                        else if(am.op == OP_WRITE) 
-                            pcb[idx].count_write++;
-                        else if(am.op == OP_EXEC) 
-                            pcb[idx].count_exec++;
-                        // Remove de running se era o atual
-                        if(current_pid == am.pid){
-                            current_pid = -1;
-                        }
-
-                        // coloca na fila do dispositivo
-                        if(am.device == DEVICE_D1) {
-                            q_push(&blocked_d1_q, am.pid);
-                            pcb[idx].count_d1++;
-                        }
-                        else {
-                            q_push(&blocked_d2_q, am.pid);
-                            pcb[idx].count_d2++;
-                        }
-
-                        printf( "[Kernel] %s fez SYSCALL %s em %s, agora BLOQUEADO\n", pcb[idx].name, op_str(am.op), dev_str(am.device));
-                        
-
-                        // Escalone imediatamente outro se houver
-                        if(!q_empty(&ready_q)){
-                            pid_t next = q_pop(&ready_q);
-                            int nidx = app_index_from_pid(next);
-                            if(nidx >= 0 && pcb[nidx].state == READY){
-                                switch_to(next);
-                            }
-                        }
-                    }
-                } else if(am.type == APP_TERMINATED){ // se o app terminou 
-                    int idx = app_index_from_pid(am.pid);
-                    if(idx >= 0 && pcb[idx].state != TERMINATED){
-                        pcb[idx].state = TERMINATED;
-                        pcb[idx].alive = false;
-                        if(current_pid == am.pid) 
-                            current_pid = -1;
-                        apps_terminated++;
-                        printf("[Kernel] %s terminou.\n", pcb[idx].name);
-                        // escalar o próximo
-                        if(!q_empty(&ready_q)){
-                            pid_t next = q_pop(&ready_q);
-                            int nidx = app_index_from_pid(next);
-                            if(nidx >= 0 && pcb[nidx].state == READY){
-                                switch_to(next);
-                            }
-                        }
-                    }
-                } else if (am.type == APP_PROGRESS) { // se for uma mensagem  de progresso (atualização de PC)
-                    int idx = app_index_from_pid(am.pid);
-                    if (idx >= 0 && pcb[idx].state != TERMINATED) {
-                        pcb[idx].pc = am.op; // atualiza o PC
-                    }
-                }
-            }
-        }
+int num_cpus = 1; // CPUs simuladas (-c)
+int affinity_pct = 0; // porcentagem de apps fixados na CPU de origem (-a)
+Cpu cpus[MAX_CPUS];
 
-        // 2) Mensagens de IRQ (IRQ0/1/2)
-        if(FD_ISSET(irq_pipe[0], &rds)){ //verifica se o pipe de leitura de irq do kernel possui algum conteúdo
-            while(1){
-                IRQMsg im;
-                int n = read(irq_pipe[0], &im, sizeof(im));
-                if(n < 0){
-                    if(errno==EAGAIN || errno==EWOULDBLOCK) // se o pipe estiver vazio, volta para o loop principal
-                        break;
-                    printf("Erro na leitura do pipe de IRQs\n");
-                    break;
-                }
-                if(n == 0) //se o escritor fechou, volta para loop principal do kernel
-                    break;
+// O kernel só conversa com as estruturas de prontos (uma por CPU) através destas funções
+typedef struct {
+    char *name;
+    void (*init)(Cpu *c);
+    void (*enqueue)(Cpu *c, int idx); // idx ficou READY (novo ou preemptado)
+    int (*pick_next)(Cpu *c); // retira o próximo a executar da estrutura de prontos; -1 se vazia
+    int (*tick)(Cpu *c, int idx); // IRQ0 com idx executando (-1 = CPU ociosa); true se deve haver nova escolha
+    void (*unblock)(Cpu *c, int idx); // idx voltou de um dispositivo e ficou READY
+    int (*ready_count)(Cpu *c);
+    void (*remove)(Cpu *c, int idx); // idx saiu de READY sem ser escolhido (syscall ou término que cruzou com a preempção)
+    void (*each)(Cpu *c, void (*fn)(int idx)); // visita cada app da estrutura de prontos (roubo com afinidade e verificação -C)
+} SchedPolicy;
 
-                if(im.type == IRQ_TIMESLICE){
-                    // pegar o proximo e trocar 
-                    if(!q_empty(&ready_q)){
-                        pid_t next = q_pop(&ready_q);
-                        int nidx = app_index_from_pid(next);
-                        if(nidx >= 0){
-                            // Garante que next esteja marcado READY
-                            if(pcb[nidx].state == READY){
-                                switch_to(next);
-                            }
-                        }
-                    } 
-                } else if(im.type == IRQ_IO_D1 || im.type == IRQ_IO_D2){
-                    PIDQueue *bq;
-                    if (im.type == IRQ_IO_D1)
-                        bq = &blocked_d1_q;
-                    else
-                        bq = &blocked_d2_q;
-                    if(!q_empty(bq)){ // se não estiver vazia, libera o processo na primeira posição da  fila
-                        pid_t unb = q_pop(bq);
-                        int uidx = app_index_from_pid(unb);
-                        if(uidx >= 0 && pcb[uidx].state == BLOCKED){
-                            pcb[uidx].state = READY;
-                            pcb[uidx].blocked_dev = -1;
-                            pcb[uidx].blocked_op  = -1;
-                            q_push(&ready_q, unb);
-                            printf( "[Kernel] IRQ %s: desbloqueou %s\n", (im.type==IRQ_IO_D1?"D1":"D2"), pcb[uidx].name);
-                            
-                        }
-                    }
-                }
-            }
-        }
+void (*each_fn)(int idx); // destino das visitas que passam por uma fila de PIDs
+static void each_pid(pid_t p){
+    each_fn(app_index_from_pid(p));
+}
 
-        //Recolhe apps que já estão terminated
-        while(1){
-            int status;
-            int w = waitpid(-1, &status, WNOHANG); // espera qualquer filho terminar. se ninguém terminou, não bloquear o kernel (WNOHANG)
-            if(w <= 0) 
-                break;
-        }
+// Round-robin: a fila FIFO original
+void rr_init(Cpu *c){
+    q_init(&c->rq);
+}
+void rr_enqueue(Cpu *c, int idx){
+    q_push(&c->rq, pt.pid[idx]);
+}
+int rr_pick_next(Cpu *c){
+    while(!q_empty(&c->rq)){
+        int idx = app_index_from_pid(q_pop(&c->rq));
+        if(idx >= 0 && pt.state[idx] == READY) // garante que o escolhido esteja marcado READY
+            return idx;
     }
-
-    // encerra qualquer resto de processo que ainda não tenha terminado
-    for(int i=0;i<NUM_PROCS_APP;i++){
-        if(pcb[i].alive){
-            kill(pcb[i].pid, SIGKILL);
-            waitpid(pcb[i].pid, NULL, 0);
-        }
+    return -1;
+}
+int rr_tick(Cpu *c, int idx){
+    return true; // todo fim de timeslice troca (se houver alguém pronto)
+}
+int rr_ready_count(Cpu *c){
+    return c->rq.size;
+}
+void rr_remove(Cpu *c, int idx){
+    q_remove(&c->rq, pt.pid[idx]);
+}
+void rr_each(Cpu *c, void (*fn)(int idx)){
+    each_fn = fn;
+    q_each(&c->rq, each_pid);
+}
+
+// MLFQ: uma fila FIFO por nível e um bitmap de níveis não vazios (o mais prioritário sai com ctz)
+void mlfq_init(Cpu *c){
+    for(int l=0;l<MLFQ_LEVELS;l++)
+        q_init(&c->mlfq_q[l]);
+    c->mlfq_mask = 0;
+    c->mlfq_count = 0;
+}
+void mlfq_enqueue(Cpu *c, int idx){
+    int l = pt.sched[idx].level;
+    q_push(&c->mlfq_q[l], pt.pid[idx]);
+    c->mlfq_mask |= 1u << l;
+    pt.sched[idx].enq_tick = sched_ticks;
+    c->mlfq_count++;
+}
+int mlfq_pick_next(Cpu *c){
+    while(c->mlfq_mask){
+        int l = __builtin_ctz(c->mlfq_mask);
+        int idx = app_index_from_pid(q_pop(&c->mlfq_q[l]));
+        if(q_empty(&c->mlfq_q[l]))
+            c->mlfq_mask &= ~(1u << l);
+        c->mlfq_count--;
+        if(idx >= 0 && pt.state[idx] == READY)
+            return idx;
+    }
+    return -1;
+}
+// Envelhecimento: quem espera MLFQ_AGING_TICKS num nível inferior sobe um nível.
+// As filas são FIFO, então basta olhar o início de cada uma.
+// Com -A sched_ticks conta ticks de ADAPT_TICK_MS: a espera é convertida para o mesmo tempo de TIMESLICE_MS.
+void mlfq_age(Cpu *c){
+    long aging = adapt_target_ns ? MLFQ_AGING_TICKS * TIMESLICE_MS / ADAPT_TICK_MS : MLFQ_AGING_TICKS;
+    for(int l=1;l<MLFQ_LEVELS;l++){
+        while(!q_empty(&c->mlfq_q[l])){
+            int idx = app_index_from_pid(q_front(&c->mlfq_q[l]));
+            if(idx >= 0 && sched_ticks - pt.sched[idx].enq_tick < aging)
+                break;
+            q_pop(&c->mlfq_q[l]);
+            c->mlfq_count--;
+            if(q_empty(&c->mlfq_q[l]))
+                c->mlfq_mask &= ~(1u << l);
+            if(idx < 0)
+                continue;
+            pt.sched[idx].level = l - 1;
+            pt.sched[idx].ticks_used = 0;
+            mlfq_enqueue(c, idx);
+        }
+    }
+}
+int mlfq_tick(Cpu *c, int idx){
+    mlfq_age(c);
+    if(idx < 0)
+        return true;
+    SchedState *p = &pt.sched[idx];
+    if(++p->ticks_used >= (1 << p->level)){ // gastou o quantum do nível: desce
+        if(p->level < MLFQ_LEVELS - 1)
+            p->level++;
+        p->ticks_used = 0;
+        return true;
+    }
+    return (c->mlfq_mask & ((1u << p->level) - 1)) != 0; // alguém mais prioritário esperando
+}
+int mlfq_ready_count(Cpu *c){
+    return c->mlfq_count;
+}
+void mlfq_remove(Cpu *c, int idx){
+    for(int l=0;l<MLFQ_LEVELS;l++){
+        if(q_remove(&c->mlfq_q[l], pt.pid[idx])){
+            if(q_empty(&c->mlfq_q[l]))
+                c->mlfq_mask &= ~(1u << l);
+            c->mlfq_count--;
+            return;
+        }
+    }
+}
+void mlfq_each(Cpu *c, void (*fn)(int idx)){
+    each_fn = fn;
+    for(int l=0;l<MLFQ_LEVELS;l++)
+        q_each(&c->mlfq_q[l], each_pid);
+}
+
+// Loteria: árvore de Fenwick com os bilhetes dos prontos; sorteio e remoção em O(log n)
+int lot_size; // potência de 2 >= num_procs_app
+
+void lot_add(Cpu *c, int idx, long long v){
+    for(int i=idx+1;i<=lot_size;i+=i&-i)
+        c->lot_tree[i] += v;
+}
+void lottery_init(Cpu *c){
+    lot_size = 1;
+    while(lot_size < num_procs_app)
+        lot_size <<= 1;
+    c->lot_tree = calloc(lot_size + 1, sizeof(long long));
+    c->lot_bits = calloc(pt.words, sizeof(uint64_t));
+    if(c->lot_tree == NULL || c->lot_bits == NULL){
+        printf("Erro na alocação da loteria\n");
+        exit(1);
+    }
+    c->lot_total = 0;
+    c->lot_count = 0;
+}
+void lottery_enqueue(Cpu *c, int idx){
+    lot_add(c, idx, pt.sched[idx].tickets);
+    c->lot_bits[idx >> 6] |= 1ULL << (idx & 63);
+    c->lot_total += pt.sched[idx].tickets;
+    c->lot_count++;
+}
+void lottery_remove(Cpu *c, int idx){
+    if(!((c->lot_bits[idx >> 6] >> (idx & 63)) & 1))
+        return;
+    c->lot_bits[idx >> 6] &= ~(1ULL << (idx & 63));
+    lot_add(c, idx, -pt.sched[idx].tickets);
+    c->lot_total -= pt.sched[idx].tickets;
+    c->lot_count--;
+}
+// Sorteia um índice proporcionalmente aos bilhetes e tira os bilhetes dele da árvore
+int lottery_draw(Cpu *c){
+    unsigned long long hi = rng_next(&sched_rng); // em comandos separados: a ordem das duas chamadas fica definida
+    unsigned lo = rng_next(&sched_rng);
+    long long r = (long long)((hi << 32 | lo) % (unsigned long long)c->lot_total);
+    int pos = 0; // desce na árvore procurando o primeiro prefixo > r
+    for(int step=lot_size;step>0;step>>=1){
+        if(pos + step <= lot_size && c->lot_tree[pos + step] <= r){
+            pos += step;
+            r -= c->lot_tree[pos];
+        }
+    }
+    int idx = pos; // pos é a quantidade de índices com prefixo <= r
+    lottery_remove(c, idx);
+    return idx;
+}
+int lottery_pick_next(Cpu *c){
+    while(c->lot_total > 0){
+        int idx = lottery_draw(c);
+        if(pt.state[idx] == READY)
+            return idx;
+    }
+    return -1;
+}
+int lottery_ready_count(Cpu *c){
+    return c->lot_count;
+}
+void lottery_each(Cpu *c, void (*fn)(int idx)){ // a árvore só guarda somas: os membros estão no bitmap
+    for(int i=bits_next(c->lot_bits, 0);i>=0;i=bits_next(c->lot_bits, i + 1))
+        fn(i);
+}
+
+// Stride: menor passo executa; cada timeslice consumido avança o passo em STRIDE1/bilhetes
+void heap_policy_init(Cpu *c){
+    key_heap_init(&c->heap);
+    c->heap_floor = 0;
+}
+void stride_enqueue(Cpu *c, int idx){
+    key_heap_push(&c->heap, pt.sched[idx].pass, idx);
+}
+int stride_pick_next(Cpu *c){
+    while(c->heap.size > 0){
+        KeyItem it = key_heap_pop(&c->heap);
+        if(pt.state[it.idx] != READY)
+            continue;
+        c->heap_floor = it.key;
+        return it.idx;
+    }
+    return -1;
+}
+int stride_tick(Cpu *c, int idx){
+    if(idx >= 0)
+        pt.sched[idx].pass += STRIDE1 / pt.sched[idx].tickets;
+    return true;
+}
+void stride_unblock(Cpu *c, int idx){
+    if(pt.sched[idx].pass < c->heap_floor) // não acumula crédito enquanto bloqueado
+        pt.sched[idx].pass = c->heap_floor;
+    stride_enqueue(c, idx);
+}
+int heap_ready_count(Cpu *c){
+    return c->heap.size;
+}
+void heap_each(Cpu *c, void (*fn)(int idx)){
+    for(int i=0;i<c->heap.size;i++)
+        fn(c->heap.it[i].idx);
+}
+void heap_remove(Cpu *c, int idx){
+    key_heap_remove(&c->heap, idx);
+}
+
+// CFS: menor vruntime (CPU consumida + ajuste) executa
+long long cfs_vruntime(int idx){
+    return pt.sched[idx].cpu_ns + pt.sched[idx].vr_bias;
+}
+void cfs_enqueue(Cpu *c, int idx){
+    key_heap_push(&c->heap, cfs_vruntime(idx), idx);
+}
+int cfs_pick_next(Cpu *c){
+    while(c->heap.size > 0){
+        KeyItem it = key_heap_pop(&c->heap);
+        if(pt.state[it.idx] != READY)
+            continue;
+        if(it.key > c->heap_floor)
+            c->heap_floor = it.key;
+        return it.idx;
+    }
+    return -1;
+}
+void cfs_unblock(Cpu *c, int idx){
+    // quem dormiu volta no máximo meio timeslice atrás do mínimo, para não monopolizar a CPU
+    long long floor = c->heap_floor - timeslice_ms * 1000000LL / 2;
+    if(cfs_vruntime(idx) < floor)
+        pt.sched[idx].vr_bias += floor - cfs_vruntime(idx);
+    cfs_enqueue(c, idx);
+}
+
+// O(1): uma fila por prioridade e um bitmap das não vazias; a mais prioritária sai com um ctz.
+// Quem gasta o timeslice vai para o vetor de expirados, que vira o ativo quando este esvazia, então
+// nenhuma prioridade baixa passa fome. Prioridade efetiva = estática + bônus: voltar de E/S ganha
+// PRIO_IO_BOOST níveis e cada timeslice inteiro custa um, o que favorece os apps interativos.
+int nice_list[MAX_NICE]; // -N: nice de cada app, em ciclo
+int nice_count = 0;
+
+int o1_prio(int idx){
+    int p = pt.sched[idx].static_prio + pt.sched[idx].bonus;
+    return p < 0 ? 0 : p >= PRIO_LEVELS ? PRIO_LEVELS - 1 : p;
+}
+void o1_init(Cpu *c){
+    for(int a=0;a<2;a++){
+        for(int l=0;l<PRIO_LEVELS;l++)
+            q_init(&c->prio_q[a][l]);
+        c->prio_mask[a] = 0;
+    }
+    c->prio_active = 0;
+    c->prio_count = 0;
+}
+void o1_enqueue(Cpu *c, int idx){
+    int a = c->prio_active ^ (pt.sched[idx].expired != 0);
+    int l = o1_prio(idx);
+    pt.sched[idx].expired = false;
+    q_push(&c->prio_q[a][l], pt.pid[idx]);
+    c->prio_mask[a] |= 1ULL << l;
+    c->prio_count++;
+}
+int o1_pick_next(Cpu *c){
+    while(c->prio_count > 0){
+        if(c->prio_mask[c->prio_active] == 0) // ativo vazio: troca com o expirado
+            c->prio_active ^= 1;
+        int a = c->prio_active;
+        int l = __builtin_ctzll(c->prio_mask[a]);
+        int idx = app_index_from_pid(q_pop(&c->prio_q[a][l]));
+        if(q_empty(&c->prio_q[a][l]))
+            c->prio_mask[a] &= ~(1ULL << l);
+        c->prio_count--;
+        if(idx >= 0 && pt.state[idx] == READY)
+            return idx;
+    }
+    return -1;
+}
+int o1_tick(Cpu *c, int idx){
+    if(idx < 0)
+        return true;
+    if(pt.sched[idx].bonus < PRIO_BONUS_MAX) // gastou o timeslice inteiro: penalidade
+        pt.sched[idx].bonus++;
+    pt.sched[idx].expired = true;
+    return true;
+}
+void o1_unblock(Cpu *c, int idx){
+    pt.sched[idx].bonus -= PRIO_IO_BOOST;
+    if(pt.sched[idx].bonus < -PRIO_BONUS_MAX)
+        pt.sched[idx].bonus = -PRIO_BONUS_MAX;
+    o1_enqueue(c, idx);
+    // mais prioritário que o atual: toma a CPU no fim do lote, sem esperar o tick
+    int cidx = c->current_pid > 0 ? app_index_from_pid(c->current_pid) : -1;
+    if(cidx < 0 || o1_prio(idx) < o1_prio(cidx))
+        c->need_resched = true;
+}
+int o1_ready_count(Cpu *c){
+    return c->prio_count;
+}
+void o1_remove(Cpu *c, int idx){
+    int l = o1_prio(idx); // bônus e prioridade não mudam enquanto o app espera
+    for(int a=0;a<2;a++){
+        if(q_remove(&c->prio_q[a][l], pt.pid[idx])){
+            if(q_empty(&c->prio_q[a][l]))
+                c->prio_mask[a] &= ~(1ULL << l);
+            c->prio_count--;
+            return;
+        }
+    }
+}
+void o1_each(Cpu *c, void (*fn)(int idx)){
+    each_fn = fn;
+    for(int a=0;a<2;a++)
+        for(int l=0;l<PRIO_LEVELS;l++)
+            q_each(&c->prio_q[a][l], each_pid);
+}
+
+SchedPolicy policies[] = {
+    { "rr",      rr_init,          rr_enqueue,      rr_pick_next,      rr_tick,     rr_enqueue,      rr_ready_count,      rr_remove,      rr_each },
+    { "mlfq",    mlfq_init,        mlfq_enqueue,    mlfq_pick_next,    mlfq_tick,   mlfq_enqueue,    mlfq_ready_count,    mlfq_remove,    mlfq_each },
+    { "lottery", lottery_init,     lottery_enqueue, lottery_pick_next, rr_tick,     lottery_enqueue, lottery_ready_count, lottery_remove, lottery_each },
+    { "stride",  heap_policy_init, stride_enqueue,  stride_pick_next,  stride_tick, stride_unblock,  heap_ready_count,    heap_remove,    heap_each },
+    { "cfs",     heap_policy_init, cfs_enqueue,     cfs_pick_next,     rr_tick,     cfs_unblock,     heap_ready_count,    heap_remove,    heap_each },
+    { "o1",      o1_init,          o1_enqueue,      o1_pick_next,      o1_tick,     o1_unblock,      o1_ready_count,      o1_remove,      o1_each },
+};
+SchedPolicy *sched = &policies[0];
+
+// Entradas e saídas das estruturas de prontos passam por aqui, que mantém o movable de cada CPU
+void ready_enqueue(Cpu *c, int idx){
+    c->movable += !pt.sched[idx].pinned;
+    sched->enqueue(c, idx);
+}
+void ready_unblock(Cpu *c, int idx){
+    c->movable += !pt.sched[idx].pinned;
+    sched->unblock(c, idx);
+}
+int ready_pick(Cpu *c){
+    int idx = sched->pick_next(c);
+    if(idx >= 0)
+        c->movable -= !pt.sched[idx].pinned;
+    return idx;
+}
+void ready_remove(Cpu *c, int idx){
+    c->movable -= !pt.sched[idx].pinned;
+    sched->remove(c, idx);
+}
+
+// --------------- Dispositivos de E/S ---------------
+// Sem -D: os dois dispositivos originais, em que uma IRQ sorteada libera o primeiro da fila.
+// Com -D: cada dispositivo tem tempos de serviço por operação, profundidade (pedidos atendidos ao
+// mesmo tempo) e ordem de atendimento; a IRQ de término acontece quando o serviço acaba.
+#define IO_READ_EXPIRE_MS 500 // deadline: prazo de leitura (leituras bloqueiam quem espera)
+#define IO_WRITE_EXPIRE_MS 5000 // deadline: prazo de escrita e exec
+
+typedef enum {
+    IO_FIFO = 0,
+    IO_SJF = 1, // menor tempo de serviço primeiro
+    IO_DEADLINE = 2 // menor prazo (chegada + expiração da operação) primeiro
+} IoOrder;
+char *io_order_names[] = { "fifo", "sjf", "deadline" };
+
+typedef enum {
+    DIST_CONST = 0, // sempre a
+    DIST_EXP = 1, // exponencial com média a
+    DIST_UNIFORM = 2 // uniforme em [a, b]
+} DistKind;
+
+typedef struct {
+    int kind; // DistKind
+    long long a, b; // ns
+} ServiceDist;
+
+typedef struct {
+    PIDQueue q; // sem -D: bloqueados em ordem de chegada
+    // modelo de serviço (-D)
+    int depth; // pedidos em serviço ao mesmo tempo
+    int order; // IoOrder
+    ServiceDist service[3]; // por Operation
+    KeyHeap pending; // pedidos esperando, pela chave da ordem
+    int in_flight;
+    long long seq; // chave FIFO
+    // estatísticas
+    long completed;
+    long long service_sum; // ns de serviço dos pedidos concluídos
+    long long busy_ns, busy_since; // tempo com pelo menos um pedido em serviço
+    int max_queue;
+} IODevice;
+
+// Pedido de E/S de um app (cada app tem no máximo um pendente)
+typedef struct {
+    int dev;
+    long long service_ns;
+} IoReq;
+
+IODevice devs[MAX_DEVICES];
+int num_devices = 2;
+int io_model = false; // algum -D foi dado
+IoReq *io_req; // por app (só com -D)
+Rng io_rng; // sorteio dos tempos de serviço
+long long io_t0; // início da simulação (para a utilização)
+
+void devices_init(){
+    for(int d=0;d<num_devices;d++){
+        q_init(&devs[d].q);
+        if(io_model)
+            key_heap_init(&devs[d].pending);
+    }
+    if(io_model){
+        io_req = calloc(num_procs_app, sizeof(IoReq));
+        if(io_req == NULL){
+            printf("Erro na alocação dos pedidos de E/S\n");
+            exit(1);
+        }
+        rng_seed(&io_rng, sim_seed + 2);
+    }
+    io_t0 = now_ns();
+}
+
+// Apps bloqueados em algum dispositivo
+int devices_blocked(){
+    int n = 0;
+    for(int d=0;d<num_devices;d++)
+        n += devs[d].q.size;
+    return n;
+}
+
+long long dist_sample(ServiceDist *sd){
+    switch(sd->kind){
+        case DIST_EXP: {
+            double u = (rng_next(&io_rng) + 1.0) / 4294967297.0; // em (0, 1)
+            return (long long)(-log(u) * sd->a);
+        }
+        case DIST_UNIFORM:
+            return sd->a + (long long)(((unsigned long long)rng_next(&io_rng) * (unsigned long long)(sd->b - sd->a + 1)) >> 32);
+    }
+    return sd->a;
+}
+
+// Lê "const:MS", "exp:MS" ou "uniform:MS:MS" (MS pode ter casas decimais)
+static int parse_dist(char *v, ServiceDist *sd){
+    char *end;
+    if(strncmp(v, "const:", 6) == 0)
+        sd->kind = DIST_CONST, v += 6;
+    else if(strncmp(v, "exp:", 4) == 0)
+        sd->kind = DIST_EXP, v += 4;
+    else if(strncmp(v, "uniform:", 8) == 0)
+        sd->kind = DIST_UNIFORM, v += 8;
+    else
+        return -1;
+    sd->a = (long long)(strtod(v, &end) * 1e6);
+    sd->b = sd->a;
+    if(sd->kind == DIST_UNIFORM){
+        if(*end != ':')
+            return -1;
+        sd->b = (long long)(strtod(end + 1, &end) * 1e6);
+    }
+    if(*end != '\0' && *end != ',')
+        return -1;
+    return sd->a >= 0 && sd->b >= sd->a ? 0 : -1;
+}
+
+// -D "depth=K,order=fifo|sjf|deadline,read=DIST,write=DIST,exec=DIST,all=DIST": acrescenta um dispositivo
+void parse_device(char *spec){
+    if(!io_model){ // o primeiro -D substitui os dois dispositivos sorteados
+        io_model = true;
+        num_devices = 0;
+    }
+    if(num_devices == MAX_DEVICES){
+        printf("No máximo %d dispositivos\n", MAX_DEVICES);
+        exit(1);
+    }
+    IODevice *dv = &devs[num_devices++];
+    dv->depth = 1;
+    dv->order = IO_FIFO;
+    for(int op=0;op<3;op++)
+        dv->service[op] = (ServiceDist){ DIST_EXP, 1000000000LL, 1000000000LL }; // exp:1000
+    for(char *p=spec; p && *p; ){
+        int bad = false;
+        if(strncmp(p, "depth=", 6) == 0){
+            dv->depth = atoi(p + 6);
+            bad = dv->depth <= 0;
+        } else if(strncmp(p, "order=", 6) == 0){
+            p += 6;
+            for(dv->order=IO_DEADLINE; dv->order>=0; dv->order--){
+                size_t n = strlen(io_order_names[dv->order]);
+                if(strncmp(p, io_order_names[dv->order], n) == 0 && (p[n] == ',' || p[n] == '\0'))
+                    break;
+            }
+            bad = dv->order < 0;
+        } else if(strncmp(p, "read=", 5) == 0)
+            bad = parse_dist(p + 5, &dv->service[OP_READ]) < 0;
+        else if(strncmp(p, "write=", 6) == 0)
+            bad = parse_dist(p + 6, &dv->service[OP_WRITE]) < 0;
+        else if(strncmp(p, "exec=", 5) == 0)
+            bad = parse_dist(p + 5, &dv->service[OP_EXEC]) < 0;
+        else if(strncmp(p, "all=", 4) == 0){
+            bad = parse_dist(p + 4, &dv->service[OP_READ]) < 0;
+            dv->service[OP_WRITE] = dv->service[OP_EXEC] = dv->service[OP_READ];
+        } else
+            bad = true;
+        if(bad){
+            printf("Dispositivo inválido: %s\n", spec);
+            exit(1);
+        }
+        p = strchr(p, ',');
+        if(p)
+            p++;
+    }
+}
+
+
+// --------------- Trace binário ---------------
+// O kernel só copia um TraceRec de tamanho fixo para um anel pré-alocado (produtor único); uma thread
+// escritora esvazia o anel no arquivo em blocos. Se o anel encher, o registro é descartado e contado.
+// O arquivo é decodificado pelo simtrace (texto ou CSV).
+#define TRACE_RING_RECS (1 << 16) // capacidade do anel (potência de 2)
+#define TRACE_IDLE_US 1000 // espera da thread escritora com o anel vazio
+
+char *trace_path = NULL; // arquivo do trace (--trace); NULL = desligado
+int trace_level = 2; // --trace-level: 1 = ciclo de vida, 2 = + escalonamento, 3 = + progresso e ticks
+static const int trace_event_level[TR_NUM_EVENTS] = {
+    [TR_READY] = 1, [TR_TERMINATE] = 1,
+    [TR_DISPATCH] = 2, [TR_PREEMPT] = 2, [TR_SYSCALL] = 2, [TR_UNBLOCK] = 2, [TR_STEAL] = 2,
+    [TR_PROGRESS] = 3, [TR_TICK] = 3,
+};
+
+typedef struct {
+    TraceRec *recs;
+    _Alignas(64) atomic_ulong tail; // próxima posição escrita pelo kernel
+    _Alignas(64) atomic_ulong head; // próxima posição gravada pela thread escritora
+    atomic_int stop;
+    int fd;
+    long long t0; // origem dos instantes do trace
+    long emitted, dropped;
+    pthread_t writer;
+} TraceRing;
+
+TraceRing trace_ring;
+int trace_on = false;
+
+#define TRACE(type, pid, cpu, dev, op) do { if(trace_on && trace_event_level[type] <= trace_level) trace_emit(type, pid, cpu, dev, op); } while(0)
+
+void trace_emit(int type, int pid, int cpu, int dev, int op){
+    TraceRing *r = &trace_ring;
+    unsigned long tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    if(tail - atomic_load_explicit(&r->head, memory_order_acquire) == TRACE_RING_RECS){
+        r->dropped++;
+        return;
+    }
+    TraceRec *rec = &r->recs[tail & (TRACE_RING_RECS - 1)];
+    rec->t = now_ns() - r->t0;
+    rec->type = type;
+    rec->pid = pid;
+    rec->cpu = cpu;
+    rec->dev = dev;
+    rec->op = op;
+    r->emitted++;
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+}
+
+static int write_all(int fd, void *buf, size_t n){
+    char *p = buf;
+    while(n > 0){
+        ssize_t w = write(fd, p, n);
+        if(w < 0){
+            if(errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += w;
+        n -= w;
+    }
+    return 0;
+}
+
+// Thread escritora: grava o trecho contíguo disponível do anel de uma vez
+static void *trace_writer(void *arg){
+    TraceRing *r = arg;
+    while(1){
+        unsigned long head = atomic_load_explicit(&r->head, memory_order_relaxed);
+        unsigned long tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+        if(head == tail){
+            if(atomic_load(&r->stop) && atomic_load(&r->tail) == head)
+                break;
+            usleep(TRACE_IDLE_US);
+            continue;
+        }
+        unsigned long pos = head & (TRACE_RING_RECS - 1);
+        unsigned long n = tail - head;
+        if(pos + n > TRACE_RING_RECS)
+            n = TRACE_RING_RECS - pos;
+        if(write_all(r->fd, &r->recs[pos], n * sizeof(TraceRec)) < 0){
+            printf("Erro na gravação do trace: %s\n", strerror(errno));
+            break;
+        }
+        atomic_store_explicit(&r->head, head + n, memory_order_release);
+    }
+    return NULL;
+}
+
+void trace_open(){
+    TraceRing *r = &trace_ring;
+    r->fd = open(trace_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(r->fd < 0){
+        printf("Erro ao abrir o trace %s: %s\n", trace_path, strerror(errno));
+        exit(1);
+    }
+    r->recs = malloc(TRACE_RING_RECS * sizeof(TraceRec));
+    if(r->recs == NULL){
+        printf("Erro na alocação do anel do trace\n");
+        exit(1);
+    }
+    atomic_init(&r->tail, 0);
+    atomic_init(&r->head, 0);
+    atomic_init(&r->stop, 0);
+    r->t0 = engine == ENGINE_DES ? 0 : mono_ns();
+    r->emitted = r->dropped = 0;
+
+    TraceHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, TRACE_MAGIC, sizeof(h.magic));
+    h.version = TRACE_VERSION;
+    h.rec_size = sizeof(TraceRec);
+    h.seed = sim_seed;
+    h.engine = engine;
+    h.num_cpus = num_cpus;
+    if(write_all(r->fd, &h, sizeof(h)) < 0 || pthread_create(&r->writer, NULL, trace_writer, r) != 0){
+        printf("Erro ao iniciar o trace\n");
+        exit(1);
+    }
+    trace_on = true;
+}
+
+// Para a thread escritora depois de ela gravar tudo o que ainda está no anel
+void trace_close(){
+    if(!trace_on)
+        return;
+    trace_on = false;
+    atomic_store(&trace_ring.stop, 1);
+    pthread_join(trace_ring.writer, NULL);
+    close(trace_ring.fd);
+    printf("[Trace] %ld registros em %s (%ld descartados com o anel cheio)\n",
+           trace_ring.emitted, trace_path, trace_ring.dropped);
+}
+
+//Função para imprimir a tabela de status dos processos. é chamada quando a flag de sigint está como 1. 
+//A função fprintf é usada para imprimir no stderr,
+void print_status_table(){
+    printf("\n===== STATUS (Kernel PID = %d) =====\n", getpid());
+    printf(" PID     | Name |   State   |  PC  | Blocked | Op   | R  W  X |");
+    for(int d=0;d<num_devices;d++) // um contador de acessos por dispositivo configurado (-D)
+        printf("  %sACS  |", dev_str(d));
+    printf(" \n");
+    printf("--------------------------------------------------------------\n");
+    for(int i=0;i<num_procs_app;i++){
+        ProcStats *p = &pt.stats[i];
+        printf(" %-7d | %-4s | %-9s | %-4d | ", pt.pid[i], p->name, state_str(pt.state[i]), proc_pc(i));
+        if(pt.state[i] == BLOCKED){
+            printf("%-7s | %-4s | ", dev_str(p->blocked_dev), op_str(p->blocked_op));
+        } else {
+            printf("%-7s | %-4s | ", "-", "-");
+        }
+        printf("%-2d %-2d %-2d", p->count_read, p->count_write, p->count_exec);
+        for(int d=0;d<num_devices;d++)
+            printf(" %7d  ", p->count_dev[d]);
+        printf("\n");
+    }
+    int ready = 0;
+    for(int c=0;c<num_cpus;c++)
+        ready += sched->ready_count(&cpus[c]);
+    printf(" ReadyQ size=%d (%s)", ready, sched->name);
+    for(int d=0;d<num_devices;d++)
+        printf(" | %sQ=%d", dev_str(d), io_model ? devs[d].pending.size + devs[d].in_flight : devs[d].q.size);
+    printf("\n");
+    printf(" READY=%d RUNNING=%d BLOCKED=%d TERMINATED=%d | vivos=%d\n", pt.count[READY], pt.count[RUNNING],
+           pt.count[BLOCKED], pt.count[TERMINATED], bits_count(pt.alive));
+    if(num_cpus > 1){
+        for(int c=0;c<num_cpus;c++)
+            printf(" CPU%d: atual=%d prontos=%d\n", c, cpus[c].current_pid, sched->ready_count(&cpus[c]));
+    }
+    printf("================================\n\n");
+}
+
+// Página de estatísticas ao vivo (--stats): um arquivo mapeado com a tabela de status, republicado
+// no máximo a cada STATS_PERIOD_MS de relógio real sob um seqlock. O simstat lê a página a qualquer
+// momento sem sinalizar nem parar o kernel.
+#define STATS_PERIOD_MS 100
+
+_Static_assert(MAX_CPUS <= STATS_MAX_CPUS && MAX_DEVICES <= STATS_MAX_DEVICES, "página de estatísticas pequena demais");
+
+char *stats_path = NULL; // arquivo da página (--stats); NULL = desligada
+StatsHeader *stats_page;
+StatsProc *stats_procs; // logo depois do cabeçalho
+size_t stats_len;
+long long stats_last; // relógio monotônico da última publicação
+long long stats_t0; // início da simulação (t_ns é relativo a ele)
+
+long long adapt_qmin();
+
+void stats_open(){
+    int fd = open(stats_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    stats_len = sizeof(StatsHeader) + (size_t)num_procs_app * sizeof(StatsProc);
+    if(fd < 0 || ftruncate(fd, stats_len) < 0){
+        printf("Erro ao criar a página de estatísticas %s: %s\n", stats_path, strerror(errno));
+        exit(1);
+    }
+    stats_page = mmap(NULL, stats_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(stats_page == MAP_FAILED){
+        printf("Erro ao mapear a página de estatísticas\n");
+        exit(1);
+    }
+    stats_procs = (StatsProc *)(stats_page + 1);
+    // campos fixos; o magic vai por último para o leitor não aceitar uma página pela metade
+    stats_page->version = STATS_VERSION;
+    stats_page->rec_size = sizeof(StatsProc);
+    stats_page->num_procs = num_procs_app;
+    stats_page->kernel_pid = getpid();
+    atomic_init(&stats_page->seq, 0);
+    atomic_thread_fence(memory_order_release);
+    memcpy(stats_page->magic, STATS_MAGIC, sizeof(stats_page->magic));
+    stats_last = 0;
+    stats_t0 = now_ns();
+}
+
+void stats_publish(){
+    StatsHeader *h = stats_page;
+    unsigned seq = atomic_load_explicit(&h->seq, memory_order_relaxed);
+    atomic_store_explicit(&h->seq, seq + 1, memory_order_relaxed); // ímpar: escrevendo
+    atomic_thread_fence(memory_order_release);
+
+    h->t_ns = now_ns() - stats_t0;
+    h->publications++;
+    h->engine = engine;
+    snprintf(h->policy, sizeof(h->policy), "%s", sched->name);
+    h->num_cpus = num_cpus;
+    h->num_devices = num_devices;
+    for(int st=0;st<NUM_STATES;st++)
+        h->state_count[st] = pt.count[st];
+    h->alive = bits_count(pt.alive);
+    for(int c=0;c<num_cpus;c++){
+        h->cpu_current[c] = cpus[c].current_pid;
+        h->cpu_ready[c] = sched->ready_count(&cpus[c]);
+        h->cpu_dispatches[c] = cpus[c].dispatches;
+    }
+    for(int d=0;d<num_devices;d++)
+        h->dev_queue[d] = io_model ? devs[d].pending.size + devs[d].in_flight : devs[d].q.size;
+    h->adapt_target_ns = adapt_target_ns;
+    h->adapt_qmin_ns = adapt_target_ns ? adapt_qmin() : 0;
+    h->adapt_decisions = adapt_decisions;
+    for(int i=0;i<num_procs_app;i++){
+        StatsProc *sp = &stats_procs[i];
+        ProcStats *p = &pt.stats[i];
+        sp->pid = pt.pid[i];
+        memcpy(sp->name, p->name, sizeof(sp->name));
+        sp->state = pt.state[i];
+        sp->pc = proc_pc(i);
+        sp->cpu = pt.cpu[i];
+        sp->blocked_dev = p->blocked_dev;
+        sp->blocked_op = p->blocked_op;
+        sp->count_read = p->count_read;
+        sp->count_write = p->count_write;
+        sp->count_exec = p->count_exec;
+        memcpy(sp->count_dev, p->count_dev, sizeof(p->count_dev));
+        sp->quantum_ns = pt.sched[i].quantum * timeslice_ms * 1000000LL;
+        sp->burst_ns = pt.sched[i].burst_ewma;
+        sp->block_pct = pt.sched[i].block_ewma * 100 / ADAPT_ONE;
+    }
+
+    atomic_store_explicit(&h->seq, seq + 2, memory_order_release); // par: página consistente
+}
+
+// Chamada a cada lote de despacho; o custo fora do período é uma leitura do relógio
+void stats_tick(){
+    if(stats_page == NULL)
+        return;
+    long long t = mono_ns();
+    if(t - stats_last < STATS_PERIOD_MS * 1000000LL)
+        return;
+    stats_last = t;
+    stats_publish();
+}
+
+// Publica o estado final e solta o mapeamento (o arquivo fica para consulta)
+void stats_close(){
+    if(stats_page == NULL)
+        return;
+    stats_publish();
+    munmap(stats_page, stats_len);
+    stats_page = NULL;
+}
+
+// --------------- Métricas ---------------
+// Histograma log-linear no estilo HDR: para cada potência de 2 há HIST_SUB sub-baldes,
+// então o erro relativo de qualquer percentil é no máximo 1/HIST_SUB; registro em O(1)
+#define HIST_SUB_BITS 5
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS (60 * HIST_SUB)
+
+typedef struct {
+    long counts[HIST_BUCKETS];
+    long n;
+    long long sum, max;
+} Hist;
+
+typedef enum {
+    MET_WAIT = 0, // cada intervalo na fila de prontos
+    MET_RESPONSE, // chegada até o primeiro despacho
+    MET_TURNAROUND, // chegada até o término
+    MET_ADMIT, // sistema aberto: chegada até conseguir um slot na tabela
+    MET_BLOCKED, // cada bloqueio no dispositivo d é a métrica MET_BLOCKED + d
+    MET_SWITCH = MET_BLOCKED + MAX_DEVICES, // SIGSTOP do atual até o SIGCONT do próximo dentro de switch_to (relógio real)
+    MET_QUANTUM, // quantum adaptativo concedido a cada despacho (-A)
+    MET_COUNT
+} MetricId;
+
+char *metric_names[MET_COUNT] = { "espera na fila", "resposta", "turnaround", "espera por slot",
+    "bloqueio D1", "bloqueio D2", "bloqueio D3", "bloqueio D4", "bloqueio D5", "bloqueio D6", "bloqueio D7", "bloqueio D8",
+    "troca (stop->cont)", "quantum adaptativo" };
+Hist metrics[MET_COUNT];
+
+static int hist_bucket(long long v){
+    if(v < HIST_SUB) // valores pequenos ficam exatos
+        return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB + (int)((v >> shift) & (HIST_SUB - 1));
+}
+
+// Valor representativo (meio) do balde b
+static long long hist_value(int b){
+    if(b < HIST_SUB)
+        return b;
+    int shift = b / HIST_SUB - 1;
+    long long lower = (long long)(HIST_SUB + b % HIST_SUB) << shift;
+    return lower + ((1LL << shift) >> 1);
+}
+
+void hist_record(Hist *h, long long v){
+    if(v < 0)
+        v = 0;
+    h->counts[hist_bucket(v)]++;
+    h->n++;
+    h->sum += v;
+    if(v > h->max)
+        h->max = v;
+}
+
+long long hist_percentile(Hist *h, double p){
+    if(h->n == 0)
+        return 0;
+    long target = (long)(p * h->n);
+    if(target >= h->n)
+        target = h->n - 1;
+    long seen = 0;
+    for(int b=0;b<HIST_BUCKETS;b++){
+        seen += h->counts[b];
+        if(seen > target){
+            long long v = hist_value(b);
+            return v > h->max ? h->max : v;
+        }
+    }
+    return h->max;
+}
+
+// Formata ns com a unidade mais legível
+char *fmt_ns(char *buf, long long ns){
+    if(ns < 10000)
+        sprintf(buf, "%lldns", ns);
+    else if(ns < 10000000LL)
+        sprintf(buf, "%.1fus", ns / 1e3);
+    else if(ns < 10000000000LL)
+        sprintf(buf, "%.1fms", ns / 1e6);
+    else
+        sprintf(buf, "%.1fs", ns / 1e9);
+    return buf;
+}
+
+void print_metrics(){
+    char b[5][32];
+    printf("\n===== MÉTRICAS (%s) =====\n", engine == ENGINE_DES ? "tempo virtual" : "tempo real");
+    printf(" %-21s | %9s | %10s | %9s | %9s | %9s | %10s\n", "Métrica", "n", "média", "p50", "p99", "p999", "máx"); // +1 de largura nos rótulos com acento (UTF-8)
+    for(int m=0;m<MET_COUNT;m++){
+        Hist *h = &metrics[m];
+        if(h->n == 0)
+            continue;
+        printf(" %-20s | %9ld | %9s | %9s | %9s | %9s | %9s\n", metric_names[m], h->n,
+               fmt_ns(b[0], h->sum / h->n), fmt_ns(b[1], hist_percentile(h, 0.50)),
+               fmt_ns(b[2], hist_percentile(h, 0.99)), fmt_ns(b[3], hist_percentile(h, 0.999)), fmt_ns(b[4], h->max));
+    }
+    printf("================================\n");
+}
+
+// Resumo do modelo de serviço dos dispositivos (só com -D)
+void print_devices(){
+    if(!io_model)
+        return;
+    long long total = now_ns() - io_t0;
+    char b[32];
+    printf("\n===== DISPOSITIVOS =====\n");
+    printf(" Disp | %-8s | prof | %9s | %14s | %11s | fila máx\n", "ordem", "atendidos", "serviço médio", "utilização");
+    for(int d=0;d<num_devices;d++){
+        IODevice *dv = &devs[d];
+        long long busy = dv->busy_ns + (dv->in_flight > 0 ? now_ns() - dv->busy_since : 0);
+        printf(" %-4s | %-8s | %4d | %9ld | %13s | %10.1f%% | %d\n", dev_str(d), io_order_names[dv->order], dv->depth,
+               dv->completed, fmt_ns(b, dv->completed ? dv->service_sum / dv->completed : 0),
+               total > 0 ? 100.0 * busy / total : 0.0, dv->max_queue);
+    }
+    printf("================================\n");
+}
+
+// Processo idx entrou na fila de prontos
+void mark_ready(int idx){
+    proc_set_state(idx, READY);
+    pt.stats[idx].ready_since = now_ns();
+}
+
+// Função para trocar o processo em execução
+long ctx_switches = 0; // despachos de um app diferente do atual
+int host_cpus = 1; // CPUs reais disponíveis para fixar os apps (modo real com -c > 1)
+
+// --------------- Quantum adaptativo (-A) ---------------
+// O IRQ0 passa a ser um tick fino (ADAPT_TICK_MS) e a política só vê um tick quando o app gasta o
+// quantum que recebeu no despacho. O quantum de cada app sai do seu histórico: quem costuma bloquear
+// antes do fim do quantum (interativo) recebe o dobro do seu surto médio de CPU, quem gasta o quantum
+// inteiro recebe o máximo. O resultado é limitado pela meta de resposta dividida pelos prontos da CPU
+// (cada pronto espera no máximo uma rodada) e, por baixo, pelo quantum mínimo que mantém o custo
+// das trocas (medido no modo real, ADAPT_DES_SWITCH_US no de eventos discretos) abaixo de ADAPT_OVERHEAD_PCT.
+// Menor quantum permitido: ADAPT_QMIN_MS ou o que mantém a troca abaixo do limite de custo
+long long adapt_qmin(){
+    long long qmin = ADAPT_QMIN_MS * 1000000LL;
+    long long sw = ADAPT_DES_SWITCH_US * 1000LL;
+    if(engine == ENGINE_REAL){
+        Hist *h = &metrics[MET_SWITCH];
+        sw = h->n > 0 ? h->sum / h->n : 0;
+    }
+    if(sw * (100 / ADAPT_OVERHEAD_PCT) > qmin)
+        qmin = sw * (100 / ADAPT_OVERHEAD_PCT);
+    return qmin;
+}
+
+// idx recebeu a CPU c (ou foi mantido nela): escolhe o quantum deste despacho
+void adapt_dispatch(Cpu *c, int idx){
+    SchedState *s = &pt.sched[idx];
+    long long q = ADAPT_QMAX_MS * 1000000LL;
+    if(s->block_ewma >= ADAPT_ONE / 2 && s->burst_ewma > 0 && 2 * s->burst_ewma < q)
+        q = 2 * s->burst_ewma;
+    int ready = sched->ready_count(c);
+    if(ready > 0 && adapt_target_ns / ready < q)
+        q = adapt_target_ns / ready;
+    long long qmin = adapt_qmin();
+    if(q < qmin)
+        q = qmin;
+    long long tick = timeslice_ms * 1000000LL;
+    s->quantum = (int)((q + tick - 1) / tick);
+    s->q_used = 0;
+    adapt_decisions++;
+    hist_record(&metrics[MET_QUANTUM], s->quantum * tick);
+}
+
+// idx perdeu a CPU: por bloqueio (blocked) ou por ter gasto o quantum; a CPU já foi contabilizada
+void adapt_leave(int idx, int blocked){
+    SchedState *s = &pt.sched[idx];
+    s->block_ewma = (3 * s->block_ewma + (blocked ? ADAPT_ONE : 0)) / 4;
+    if(!blocked)
+        return;
+    long long burst = s->cpu_ns - s->burst_mark;
+    s->burst_ewma = s->burst_ewma ? (3 * s->burst_ewma + burst) / 4 : burst;
+    s->burst_mark = s->cpu_ns;
+}
+
+// Tick fino na CPU em que idx executa: só repassa à política quando o quantum acabou
+int adapt_tick(int idx){
+    if(idx < 0)
+        return true;
+    SchedState *s = &pt.sched[idx];
+    if(++s->q_used < s->quantum)
+        return false;
+    s->q_used = 0; // se a política mantiver o app, o próximo quantum conta do zero
+    return true;
+}
+
+void print_adapt(){
+    if(adapt_target_ns == 0)
+        return;
+    char b[3][32];
+    printf("[Adaptativo] meta de resposta %s | tick %d ms | quantum entre %s e %s | %ld decisões | %ld trocas\n",
+           fmt_ns(b[0], adapt_target_ns), timeslice_ms, fmt_ns(b[1], adapt_qmin()), fmt_ns(b[2], ADAPT_QMAX_MS * 1000000LL),
+           adapt_decisions, ctx_switches);
+}
+
+void des_app_stop(int idx);
+void des_app_resume(int idx);
+
+// Fixa o app na CPU real correspondente à CPU simulada em que vai executar (só quando muda)
+void pin_to_host(int idx){
+#ifdef __linux__
+    int h = pt.cpu[idx] % host_cpus;
+    if(pt.stats[idx].host_cpu == h)
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(h, &set);
+    if(sched_setaffinity(pt.pid[idx], sizeof(set), &set) == 0)
+        pt.stats[idx].host_cpu = h;
+#endif
+}
+
+// Para/continua um app: sinais no modo real, eventos de CPU no modo de eventos discretos
+void proc_stop(int idx){
+    if(engine == ENGINE_DES)
+        des_app_stop(idx);
+    else if(suspend_mode == SUSPEND_FUTEX)
+        permit_revoke(idx);
+    else
+        kill(pt.pid[idx], SIGSTOP);
+}
+void proc_resume(int idx){
+    if(engine == ENGINE_DES){
+        des_app_resume(idx);
+        return;
+    }
+    if(num_cpus > 1)
+        pin_to_host(idx);
+    if(suspend_mode == SUSPEND_FUTEX)
+        permit_grant(idx);
+    else
+        kill(pt.pid[idx], SIGCONT);
+}
+
+// Enfileira o processo antigo da CPU cpu (se aplicável) e troca para next_pid
+void switch_to(int cpu, pid_t next_pid){
+    Cpu *c = &cpus[cpu];
+    int nidx = app_index_from_pid(next_pid);
+    long long switch_start = -1; // instante do SIGSTOP, para medir a latência da troca
+    // Pare o atual e re-enfileire se ainda estiver RUNNING (schedule_next já o devolve READY à política)
+    if(c->current_pid > 0 && c->current_pid != next_pid){
+        int idx = app_index_from_pid(c->current_pid);
+
+        if(idx >= 0 && (pt.state[idx] == RUNNING || pt.state[idx] == READY)){
+            //Para o processo atual, seta seu estado como READY e o enfileira novamente na fila de prontos
+            if(engine == ENGINE_REAL) // no tempo virtual a troca é instantânea: só o modo real a mede
+                switch_start = mono_ns();
+            proc_stop(idx);
+            if(pt.state[idx] == RUNNING){
+                charge_cpu(idx);
+                mark_ready(idx);
+                ready_enqueue(c, idx);
+            }
+
+            TRACE(TR_PREEMPT, pt.pid[idx], cpu, -1, -1);
+            KLOG("[Kernel] Troca -> %s (fim do timeslice de %s)\n", pt.stats[nidx].name, pt.stats[idx].name);
+            
+        }
+    }
+
+    // Inicia/continua o próximo
+    if(nidx >= 0 && pt.state[nidx] == READY){
+        long long t = now_ns();
+        proc_set_state(nidx, RUNNING);
+        pt.cpu[nidx] = cpu;
+        pt.sched[nidx].run_start = t;
+        pt.stats[nidx].wait_ns += t - pt.stats[nidx].ready_since;
+        hist_record(&metrics[MET_WAIT], t - pt.stats[nidx].ready_since);
+        if(pt.stats[nidx].first_run_ns < 0){
+            pt.stats[nidx].first_run_ns = t;
+            hist_record(&metrics[MET_RESPONSE], t - pt.stats[nidx].arrival_ns);
+        }
+        c->current_pid = next_pid;
+        c->dispatches++;
+        ctx_switches++;
+        if(adapt_target_ns)
+            adapt_dispatch(c, nidx);
+        proc_resume(nidx);
+        if(switch_start >= 0)
+            hist_record(&metrics[MET_SWITCH], mono_ns() - switch_start);
+        TRACE(TR_DISPATCH, next_pid, cpu, -1, -1);
+        if(num_cpus > 1)
+            KLOG("[Kernel] CPU%d executando %s\n", cpu, pt.stats[nidx].name);
+        else
+            KLOG("[Kernel] Executando %s\n", pt.stats[nidx].name);
+       
+        
+    }
+}
+
+// InterController 
+void intercontroller_process(){
+    close(irq_pipe[0]); // fecha leitura
+    // Fechar sys_pipe no IC
+    close(sys_pipe[0]); close(sys_pipe[1]);
+
+    IRQMsg m; //Struct para envio de mensagens de IRQ
+    int r; // número aleatório
+    // semente aleatória para geração de números aleatórios
+    srand((unsigned)sim_seed);
+
+
+    while(1){
+        usleep(timeslice_ms * 1000); // espera o tempo do timeslice
+        m.type = IRQ_TIMESLICE; // gera o timeslice, um por CPU simulada
+        for(m.cpu=0;m.cpu<num_cpus;m.cpu++){
+            if(write(irq_pipe[1], &m, sizeof(m)) < 0){
+                // Kernel pode ter morrido; encerra
+                exit(0);
+            }
+        }
+        m.cpu = 0;
+        if(io_model) // com -D as IRQs de dispositivo vêm do modelo de serviço
+            continue;
+
+        // Gera IRQ1/IRQ2 de acordo com a probabilidade
+        r = rand()%100;
+        if(r < p1_prob){
+            m.type = IRQ_IO_D1;
+            write(irq_pipe[1], &m, sizeof(m));
+        }
+
+        r = rand()%100;
+        if(r < p2_prob){
+            m.type = IRQ_IO_D2;
+            write(irq_pipe[1], &m, sizeof(m));
+        }
+
+    }
+}
+
+// --------------- App ---------------
+// Envia uma mensagem ao kernel pelo transporte configurado
+static void app_send(AppMsg *m){
+    if(transport == TRANSPORT_PIPE){
+        write(sys_pipe[1], m, sizeof(*m));
+        return;
+    }
+    ShmRing *r = shm_ring;
+    unsigned pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    RingSlot *slot;
+    while(1){
+        slot = &r->slots[pos & r->mask];
+        unsigned seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        int diff = (int)(seq - pos);
+        if(diff == 0){ // slot livre nesta volta: tenta reservar
+            if(atomic_compare_exchange_weak_explicit(&r->tail, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if(diff < 0){ // anel cheio: espera o kernel consumir
+            sched_yield();
+            pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+        } else {
+            pos = atomic_load_explicit(&r->tail, memory_order_relaxed);
+        }
+    }
+    slot->msg = *m;
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+
+    // Só acorda o kernel (1 syscall) se ele anunciou que ia dormir
+    atomic_thread_fence(memory_order_seq_cst);
+    if(atomic_load_explicit(&r->sleeping, memory_order_relaxed) && atomic_exchange(&r->sleeping, 0)){
+        uint64_t one = 1;
+        write(shm_doorbell, &one, sizeof(one));
+    }
+}
+
+// --------------- Sistema aberto (-r) ---------------
+// Apps chegam num processo de Poisson de taxa arrival_rate durante open_window_s segundos e saem ao
+// terminar. A tabela (-n) é o máximo de apps simultâneos: cada slot livre (TERMINATED) é reaproveitado
+// pela próxima chegada, e chegadas sem slot esperam na fila de admissão. No modo real os slots são um
+// pool de processos criados no início que estacionam ao terminar um app, então uma chegada não custa
+// um fork: o kernel só registra o processo parado do slot como um app novo.
+double arrival_rate = 0; // chegadas por segundo; 0 = sistema fechado (todos os apps no início)
+double open_window_s = OPEN_WINDOW_S;
+long long open_t0, open_end; // janela das chegadas
+long long next_arrival; // instante da próxima chegada
+Rng arrival_rng;
+KeyHeap admit_q; // chegadas esperando slot (chave = instante da chegada)
+char *pool_parked; // SIGSTOP: o processo do slot já foi visto parado (waitpid) desde o último app
+long open_arrivals = 0, open_completed = 0;
+int admit_max = 0; // maior fila de admissão
+int open_serial = 0; // numera os apps admitidos (A1, A2, ...)
+
+// Uma iteração de CPU do app. Com o futex a CPU é consumida em fatias e o app só avança com a permissão,
+// conferida também depois da última fatia: um app preemptado nela não manda syscall, progresso nem
+// término enquanto está na fila de prontos.
+static void app_run(int app_no){
+    if(suspend_mode == SUSPEND_SIGNAL){
+        usleep(APP_STEP_MS * 1000); // 1 seg
+        return;
+    }
+    for(int ms=0;ms<APP_STEP_MS;ms+=RUN_CHUNK_MS){
+        permit_wait(app_no);
+        usleep(RUN_CHUNK_MS * 1000);
+    }
+    permit_wait(app_no);
+}
+
+static void app_process(int app_no){
+    // app_no em 0..num_procs_app-1
+    // Fechar descritores que não usa
+    close(irq_pipe[0]); close(irq_pipe[1]); // apps não usam IRQ pipe
+    close(sys_pipe[0]); // app só escreve
+
+    int r;
+    // semente aleatória por processo
+    srand(time(NULL)  ^  getpid());
+
+    while(1){ // no sistema aberto o processo volta ao pool e é readmitido como um app novo
+        int pc = 0;
+        while(pc < max_iterations){
+            app_run(app_no); // 1 seg de CPU
+
+            // Chance de syscall
+            r = rand()%100;
+            if(r < prob_syscall){
+                // escolhe device/op
+                Device d = (Device)(rand() % num_devices);
+                int opraw = rand()%3;
+                Operation op = (Operation)opraw;
+
+                AppMsg msg;
+                msg.device = (int)d;
+                msg.type = APP_SYSCALL;
+                msg.pid = getpid();
+                msg.op = (int)op; 
+
+                if(suspend_mode == SUSPEND_FUTEX){
+                    // Abre mão da permissão antes de avisar o kernel: só ele a devolve, ao desbloquear
+                    permit_revoke(app_no);
+                    app_send(&msg);
+                } else {
+                    app_send(&msg);
+                    // Envia um sigstop para si mesmo. Kernel decidirá o que vai fazer
+                    kill(getpid(), SIGSTOP);
+                }
+            
+            } else if(progress_mode == PROGRESS_SHM){
+                // avança PC no contador; o kernel lê quando precisar
+                pc++;
+                atomic_store_explicit(&pc_slots[app_no], pc, memory_order_relaxed);
+            } else {
+                // avança PC
+                pc++;
+                AppMsg progress;
+                progress.type = APP_PROGRESS;
+                progress.pid = getpid();
+                progress.device = -1;
+                progress.op = pc;
+                app_send(&progress);
+            }
+        }
+
+        // terminou
+        AppMsg done;
+        done.type = APP_TERMINATED;
+        done.pid = getpid();
+        done.device = -1;
+        done.op = -1;
+        if(arrival_rate <= 0){
+            app_send(&done);
+            exit(0);
+        }
+        // estaciona até o kernel admitir uma nova chegada neste slot (e escalá-la)
+        if(suspend_mode == SUSPEND_FUTEX){
+            permit_revoke(app_no); // antes de avisar: só a próxima admissão devolve a permissão
+            app_send(&done);
+            permit_wait(app_no);
+        } else {
+            app_send(&done);
+            kill(getpid(), SIGSTOP);
+        }
+    }
+}
+
+// --------------- Tratamento de mensagens no Kernel ---------------
+pid_t ic_pid = -1;
+
+// Preenche o PCB do app i no estado inicial (READY, PC 0, contadores zerados)
+void pcb_init(int i){
+    snprintf(pt.stats[i].name, sizeof(pt.stats[i].name), "A%d", i + 1);
+    proc_set_state(i, READY);
+    pt.pc[i] = 0;
+    if(pc_slots) // no sistema aberto o processo do slot ainda mostra o PC final do app anterior
+        atomic_store_explicit(&pc_slots[i], 0, memory_order_relaxed);
+    pt.stats[i].blocked_dev = -1;
+    pt.stats[i].blocked_op = -1;
+    pt.stats[i].count_read = pt.stats[i].count_write = pt.stats[i].count_exec = 0;
+    proc_set_alive(i, false);
+    memset(pt.stats[i].count_dev, 0, sizeof(pt.stats[i].count_dev));
+    pt.sched[i].cpu_ns = pt.sched[i].run_start = 0;
+    pt.sched[i].level = pt.sched[i].ticks_used = 0;
+    pt.sched[i].enq_tick = 0;
+    pt.sched[i].tickets = DEFAULT_TICKETS;
+    pt.sched[i].pass = pt.sched[i].vr_bias = 0;
+    pt.sched[i].static_prio = PRIO_DEFAULT + (nice_count ? nice_list[i % nice_count] : 0);
+    pt.sched[i].bonus = pt.sched[i].expired = 0;
+    pt.sched[i].quantum = pt.sched[i].q_used = pt.sched[i].block_ewma = 0;
+    pt.sched[i].burst_mark = pt.sched[i].burst_ewma = 0;
+    pt.stats[i].arrival_ns = pt.stats[i].finish_ns = pt.stats[i].ready_since = pt.stats[i].blocked_since = 0;
+    pt.stats[i].first_run_ns = -1;
+    pt.stats[i].wait_ns = 0;
+    memset(pt.stats[i].blocked_ns, 0, sizeof(pt.stats[i].blocked_ns));
+    pt.cpu[i] = i % num_cpus; // CPU de origem: distribuição circular
+    pt.sched[i].pinned = (i % 100) < affinity_pct;
+    pt.stats[i].host_cpu = -1;
+}
+
+// Associa o PID ao PCB i e enfileira o app como pronto na sua CPU de origem
+void pcb_register(int i, pid_t p){
+    pt.pid[i] = p;
+    proc_set_alive(i, true);
+    pidmap_put(&pid_map, p, i);
+    mark_ready(i);
+    pt.stats[i].arrival_ns = pt.stats[i].ready_since;
+    ready_enqueue(&cpus[pt.cpu[i]], i);
+    TRACE(TR_READY, p, pt.cpu[i], -1, -1);
+    KLOG("[Kernel] %s PID=%d pronto\n", pt.stats[i].name, p);
+}
+
+// Inicializa as CPUs simuladas e a estrutura de prontos de cada uma
+void cpus_init(){
+    for(int c=0;c<num_cpus;c++){
+        memset(&cpus[c], 0, sizeof(Cpu));
+        cpus[c].current_pid = -1;
+        sched->init(&cpus[c]);
+    }
+}
+
+// Começa executando o primeiro pronto de cada CPU
+void start_first(){
+    for(int c=0;c<num_cpus;c++){
+        int fidx = ready_pick(&cpus[c]);
+        if(fidx >= 0){
+            proc_set_state(fidx, READY);
+            switch_to(c, pt.pid[fidx]);
+        }
+    }
+}
+
+// Índice do app em execução na CPU cpu, ou -1 se ela está ociosa
+int current_index(int cpu){
+    pid_t cur = cpus[cpu].current_pid;
+    if(cur <= 0)
+        return -1;
+    int idx = app_index_from_pid(cur);
+    if(idx >= 0 && pt.state[idx] == RUNNING)
+        return idx;
+    return -1;
+}
+
+// Devolve o atual à política, pede o próximo e passa a CPU para ele (o atual pode continuar)
+void schedule_next(int cpu){
+    Cpu *c = &cpus[cpu];
+    int cidx = current_index(cpu);
+    if(cidx >= 0){
+        charge_cpu(cidx);
+        if(adapt_target_ns)
+            adapt_leave(cidx, false);
+        mark_ready(cidx);
+        ready_enqueue(c, cidx);
+    }
+    int nidx = ready_pick(c);
+    if(nidx < 0)
+        return;
+    if(nidx == cidx){ // a política manteve o mesmo processo: nada de SIGSTOP/SIGCONT
+        proc_set_state(cidx, RUNNING);
+        if(adapt_target_ns)
+            adapt_dispatch(c, cidx);
+        return;
+    }
+    switch_to(cpu, pt.pid[nidx]);
+}
+
+// Retira o app idx da CPU em que ele executava (syscall ou término) e pede nova escolha nela
+void leave_cpu(int idx){
+    Cpu *c = &cpus[pt.cpu[idx]];
+    if(c->current_pid == pt.pid[idx]){
+        charge_cpu(idx);
+        c->current_pid = -1;
+    }
+    c->need_resched = true;
+}
+
+// Fim da E/S do app uidx no dispositivo dev: volta a ficar pronto
+void unblock_app(int uidx, int dev){
+    long long blocked = now_ns() - pt.stats[uidx].blocked_since;
+    pt.stats[uidx].blocked_ns[dev] += blocked;
+    hist_record(&metrics[MET_BLOCKED + dev], blocked);
+    mark_ready(uidx);
+    pt.stats[uidx].blocked_dev = -1;
+    pt.stats[uidx].blocked_op  = -1;
+    ready_unblock(&cpus[pt.cpu[uidx]], uidx); // volta para a última CPU em que executou
+    TRACE(TR_UNBLOCK, pt.pid[uidx], pt.cpu[uidx], dev, -1);
+    KLOG("[Kernel] IRQ %s: desbloqueou %s\n", dev_str(dev), pt.stats[uidx].name);
+}
+
+// Modelo de serviço (-D): o término de cada pedido é agendado para o instante exato em que o serviço
+// acaba (evento no modo de eventos discretos, timerfd no modo real)
+void des_push_io(long long t, int idx);
+KeyHeap io_inflight; // modo real: pedidos em serviço pelo instante de término
+int io_fd = -1; // timerfd armado para o próximo término (modo real)
+
+void io_timer_arm(){
+#ifdef __linux__
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its)); // heap vazio: desarma
+    if(io_inflight.size > 0){
+        long long t = io_inflight.it[0].key;
+        if(t <= 0)
+            t = 1; // 0 desarmaria o timer
+        its.it_value.tv_sec = t / 1000000000LL;
+        its.it_value.tv_nsec = t % 1000000000LL;
+    }
+    timerfd_settime(io_fd, TFD_TIMER_ABSTIME, &its, NULL);
+#endif
+}
+
+// Coloca em serviço os próximos pedidos de d enquanto houver profundidade livre
+void io_start_pending(int d){
+    IODevice *dv = &devs[d];
+    while(dv->in_flight < dv->depth && dv->pending.size > 0){
+        int idx = key_heap_pop(&dv->pending).idx;
+        long long t = now_ns();
+        if(dv->in_flight++ == 0)
+            dv->busy_since = t;
+        if(engine == ENGINE_DES)
+            des_push_io(t + io_req[idx].service_ns, idx);
+        else {
+            key_heap_push(&io_inflight, t + io_req[idx].service_ns, idx);
+            io_timer_arm();
+        }
+    }
+}
+
+void io_submit(int idx, int d, int op){
+    IODevice *dv = &devs[d];
+    long long t = now_ns();
+    io_req[idx].dev = d;
+    io_req[idx].service_ns = dist_sample(&dv->service[op]);
+    long long key;
+    if(dv->order == IO_SJF)
+        key = io_req[idx].service_ns;
+    else if(dv->order == IO_DEADLINE)
+        key = t + (op == OP_READ ? IO_READ_EXPIRE_MS : IO_WRITE_EXPIRE_MS) * 1000000LL;
+    else
+        key = dv->seq++;
+    key_heap_push(&dv->pending, key, idx);
+    if(dv->pending.size > dv->max_queue)
+        dv->max_queue = dv->pending.size;
+    io_start_pending(d);
+}
+
+// IRQ de término do pedido do app idx
+void io_complete(int idx){
+    int d = io_req[idx].dev;
+    IODevice *dv = &devs[d];
+    dv->completed++;
+    dv->service_sum += io_req[idx].service_ns;
+    if(--dv->in_flight == 0)
+        dv->busy_ns += now_ns() - dv->busy_since;
+    if(pt.state[idx] == BLOCKED)
+        unblock_app(idx, d);
+    io_start_pending(d);
+}
+
+void handle_app_msg(AppMsg *am){
+    app_msgs++;
+    if(am->type == APP_SYSCALL){ // se for syscall
+        int idx = app_index_from_pid(am->pid);
+        if(idx >= 0 && pt.state[idx] != TERMINATED){
+            if(pt.state[idx] == READY) // preemptado logo depois de mandar a syscall: sai dos prontos
+                ready_remove(&cpus[pt.cpu[idx]], idx);
+            if(adapt_target_ns && pt.state[idx] == RUNNING){ // bloqueou antes do fim do quantum
+                charge_cpu(idx);
+                adapt_leave(idx, true);
+            }
+            // marca bloqueado e contabiliza
+            proc_set_state(idx, BLOCKED);
+            pt.stats[idx].blocked_since = now_ns();
+            pt.stats[idx].blocked_dev = am->device;
+            pt.stats[idx].blocked_op  = am->op;
+            if(am->op == OP_READ) 
+                pt.stats[idx].count_read++;
+            else if(am->op == OP_WRITE) 
+                pt.stats[idx].count_write++;
+            else if(am->op == OP_EXEC) 
+                pt.stats[idx].count_exec++;
+
+            // coloca na fila do dispositivo (ou entrega o pedido ao modelo de serviço)
+            pt.stats[idx].count_dev[am->device]++;
+            if(io_model)
+                io_submit(idx, am->device, am->op);
+            else
+                q_push(&devs[am->device].q, am->pid);
+
+            TRACE(TR_SYSCALL, am->pid, pt.cpu[idx], am->device, am->op);
+            KLOG("[Kernel] %s fez SYSCALL %s em %s, agora BLOQUEADO\n", pt.stats[idx].name, op_str(am->op), dev_str(am->device));
+
+            // Um app com a permissão concedida logo antes da syscall não pode seguir executando bloqueado
+            if(engine == ENGINE_REAL && suspend_mode == SUSPEND_FUTEX)
+                permit_revoke(idx);
+
+            // Remove de running se era o atual e escalone outro se houver (ao fim do lote)
+            leave_cpu(idx);
+        }
+    } else if(am->type == APP_TERMINATED){ // se o app terminou 
+        int idx = app_index_from_pid(am->pid);
+        if(idx >= 0 && pt.state[idx] != TERMINATED){
+            if(pt.state[idx] == READY){ // preemptado logo depois de terminar: sai dos prontos
+                ready_remove(&cpus[pt.cpu[idx]], idx);
+                // parado pelo SIGSTOP da preempção, não pelo seu: segue até se parar sozinho, senão
+                // pool_free_slot o daria por estacionado e o SIGCONT da próxima admissão se perderia
+                if(engine == ENGINE_REAL && suspend_mode == SUSPEND_SIGNAL)
+                    kill(am->pid, SIGCONT);
+            }
+            proc_set_state(idx, TERMINATED);
+            proc_pc(idx); // PC final (com -P shm ele não veio por mensagem)
+            pt.stats[idx].finish_ns = now_ns();
+            hist_record(&metrics[MET_TURNAROUND], pt.stats[idx].finish_ns - pt.stats[idx].arrival_ns);
+            if(arrival_rate > 0){ // o processo volta ao pool; o slot fica livre para a próxima chegada
+                open_completed++;
+                pool_parked[idx] = false;
+            } else
+                proc_set_alive(idx, false);
+            TRACE(TR_TERMINATE, am->pid, pt.cpu[idx], -1, -1);
+            KLOG("[Kernel] %s terminou.\n", pt.stats[idx].name);
+            // escalar o próximo (ao fim do lote)
+            leave_cpu(idx);
+        }
+    } else if (am->type == APP_PROGRESS) { // se for uma mensagem  de progresso (atualização de PC)
+        progress_msgs++;
+        int idx = app_index_from_pid(am->pid);
+        if (idx >= 0 && pt.state[idx] != TERMINATED) {
+            pt.pc[idx] = am->op; // atualiza o PC
+            TRACE(TR_PROGRESS, am->pid, pt.cpu[idx], -1, am->op);
+        }
+    }
+}
+
+void handle_irq_msg(IRQMsg *im){
+    if(im->type == IRQ_TIMESLICE){
+        Cpu *c = &cpus[im->cpu];
+        if(im->cpu == 0){ // a CPU 0 marca o período do timeslice
+            jitter_tick();
+            sched_ticks++;
+        }
+        c->ticks++;
+        int cidx = current_index(im->cpu);
+        TRACE(TR_TICK, cidx >= 0 ? pt.pid[cidx] : -1, im->cpu, -1, -1);
+        if(cidx >= 0)
+            charge_cpu(cidx);
+        else
+            c->idle_ticks++;
+        // pegar o proximo e trocar (ao fim do lote), se a política pedir; com -A só no fim do quantum
+        if((adapt_target_ns == 0 || adapt_tick(cidx)) && sched->tick(c, cidx))
+            c->need_resched = true;
+    } else if(im->type == IRQ_IO_D1 || im->type == IRQ_IO_D2){
+        PIDQueue *bq = &devs[im->type - IRQ_IO_D1].q;
+        if(!q_empty(bq)){ // se não estiver vazia, libera o processo na primeira posição da  fila
+            pid_t unb = q_pop(bq);
+            int uidx = app_index_from_pid(unb);
+            if(uidx >= 0 && pt.state[uidx] == BLOCKED)
+                unblock_app(uidx, im->type - IRQ_IO_D1);
+        }
+    }
+}
+
+// Roubo de trabalho: uma CPU ociosa e sem prontos tira um pronto da CPU com mais prontos.
+// Com afinidade (-a) só contam os apps não fixados (movable): a vítima é a CPU com mais deles e o
+// roubado é o primeiro na ordem da estrutura de prontos, retirado de onde está sem mexer nos fixados.
+int steal_candidate, steal_movable; // app roubável e quantos há na CPU visitada
+static void steal_visit(int idx){
+    if(!pt.sched[idx].pinned && steal_movable++ == 0)
+        steal_candidate = idx;
+}
+
+void steal_work(int thief){
+    int victim = -1, most = 0, idx;
+    for(int c=0;c<num_cpus;c++){
+        int n = affinity_pct > 0 ? cpus[c].movable : sched->ready_count(&cpus[c]);
+        if(c != thief && n > most){
+            most = n;
+            victim = c;
+        }
+    }
+    if(victim < 0)
+        return;
+    if(affinity_pct > 0){
+        steal_movable = 0;
+        sched->each(&cpus[victim], steal_visit);
+        idx = steal_candidate;
+        ready_remove(&cpus[victim], idx);
+    } else if((idx = ready_pick(&cpus[victim])) < 0)
+        return;
+    cpus[thief].steals++;
+    TRACE(TR_STEAL, pt.pid[idx], thief, -1, victim);
+    KLOG("[Kernel] CPU%d roubou %s da CPU%d\n", thief, pt.stats[idx].name, victim);
+    switch_to(thief, pt.pid[idx]);
+}
+
+// Com várias CPUs, uma CPU ociosa não espera a próxima IRQ0: pega da própria fila ou rouba
+void balance_cpus(){
+    for(int c=0;c<num_cpus;c++){
+        if(current_index(c) >= 0)
+            continue;
+        if(sched->ready_count(&cpus[c]) > 0)
+            schedule_next(c);
+        else
+            steal_work(c);
+    }
+}
+
+// Sistema aberto (-r): chegadas e reaproveitamento dos slots
+void des_app_reset(int idx, int serial);
+
+long long arrival_gap(){
+    double u = (rng_next(&arrival_rng) + 1.0) / 4294967297.0; // em (0, 1)
+    return (long long)(-log(u) * 1e9 / arrival_rate);
+}
+
+void open_init(){
+    rng_seed(&arrival_rng, sim_seed + 3);
+    key_heap_init(&admit_q);
+    pool_parked = calloc(num_procs_app, 1);
+    if(pool_parked == NULL){
+        printf("Erro na alocação do pool de processos\n");
+        exit(1);
+    }
+    open_t0 = now_ns();
+    open_end = open_t0 + (long long)(open_window_s * 1e9);
+    next_arrival = open_t0 + arrival_gap();
+}
+
+// Slot i livre com o processo (real ou virtual) p estacionado, à espera de uma chegada
+void pool_add(int i, pid_t p){
+    pt.pid[i] = p;
+    pidmap_put(&pid_map, p, i);
+    proc_set_alive(i, true);
+    proc_set_state(i, TERMINATED);
+    pool_parked[i] = true;
+}
+
+void open_arrive(long long t){
+    open_arrivals++;
+    key_heap_push(&admit_q, t, 0);
+    if(admit_q.size > admit_max)
+        admit_max = admit_q.size;
+}
+
+// Slot livre (achado pelo bitmap de TERMINATED) cujo processo já está estacionado, ou -1. Com sinais,
+// o processo que acabou de mandar APP_TERMINATED ainda vai se parar e um SIGCONT antes disso se
+// perderia: a parada é conferida sem bloquear o kernel e o slot fica para um próximo lote.
+int pool_free_slot(){
+    for(int i=bits_next(pt.state_bits[TERMINATED], 0);i>=0;i=bits_next(pt.state_bits[TERMINATED], i + 1)){
+        if(engine == ENGINE_REAL && suspend_mode == SUSPEND_SIGNAL && !pool_parked[i]){
+            int status;
+            if(waitpid(pt.pid[i], &status, WUNTRACED | WNOHANG) != pt.pid[i] || !WIFSTOPPED(status))
+                continue;
+        }
+        pool_parked[i] = true;
+        return i;
+    }
+    return -1;
+}
+
+// Admite as chegadas pendentes enquanto houver slot livre
+void open_admit(){
+    while(admit_q.size > 0){
+        int slot = pool_free_slot();
+        if(slot < 0)
+            return;
+        long long t = key_heap_pop(&admit_q).key;
+
+        pcb_init(slot);
+        snprintf(pt.stats[slot].name, sizeof(pt.stats[slot].name), "A%d", ++open_serial);
+        if(engine == ENGINE_DES)
+            des_app_reset(slot, open_serial);
+        // entra no piso atual da CPU (stride: passo global; cfs: min_vruntime); com 0 passaria à frente de todos
+        pt.sched[slot].pass = pt.sched[slot].vr_bias = cpus[pt.cpu[slot]].heap_floor;
+        pcb_register(slot, pt.pid[slot]);
+        hist_record(&metrics[MET_ADMIT], pt.stats[slot].arrival_ns - t);
+        pt.stats[slot].arrival_ns = t; // resposta e turnaround contam desde a chegada
+        Cpu *c = &cpus[pt.cpu[slot]];
+        if(c->current_pid < 0) // CPU ociosa pega o app no fim do lote, sem esperar o tick
+            c->need_resched = true;
+    }
+}
+
+// A cada lote: no modo real gera as chegadas vencidas (no de eventos discretos elas são eventos) e admite
+void open_tick(){
+    if(engine == ENGINE_REAL){
+        long long t = now_ns();
+        while(next_arrival <= t && next_arrival < open_end){
+            open_arrive(next_arrival);
+            next_arrival += arrival_gap();
+        }
+    }
+    open_admit();
+}
+
+// O sistema aberto só acaba depois da janela de chegadas, com a fila de admissão vazia
+int open_done(){
+    return now_ns() >= open_end && admit_q.size == 0;
+}
+
+void print_open_stats(){
+    if(arrival_rate <= 0)
+        return;
+    double secs = (now_ns() - open_t0) / 1e9;
+    printf("[Aberto] taxa %.3f apps/s por %.0f s | %ld chegadas | %ld concluídos | vazão %.3f apps/s | fila de admissão máx %d\n",
+           arrival_rate, open_window_s, open_arrivals, open_completed, secs > 0 ? open_completed / secs : 0.0, admit_max);
+}
+
+int check_on = false; // -C: confere as invariantes do kernel ao fim de cada lote
+void check_invariants();
+
+// Decisão de escalonamento, tomada uma única vez por CPU depois de tratar um lote de mensagens
+void kernel_dispatch(){
+    if(arrival_rate > 0)
+        open_tick();
+    for(int c=0;c<num_cpus;c++){
+        if(cpus[c].need_resched){
+            cpus[c].need_resched = false;
+            schedule_next(c);
+        }
+    }
+    if(num_cpus > 1)
+        balance_cpus();
+    stats_tick();
+    if(check_on)
+        check_invariants();
+}
+
+// Resumo por CPU simulada (só com -c > 1)
+void print_cpu_stats(){
+    if(num_cpus < 2)
+        return;
+    printf("\n===== CPUs =====\n");
+    printf(" CPU | %9s | %9s | %9s | %9s\n", "ticks", "ociosos", "despachos", "roubos");
+    for(int c=0;c<num_cpus;c++)
+        printf(" %3d | %9ld | %9ld | %9ld | %9ld\n", c, cpus[c].ticks, cpus[c].idle_ticks, cpus[c].dispatches, cpus[c].steals);
+    printf("================================\n");
+}
+
+// Leitura em lote: um read() traz várias mensagens; o pedaço de mensagem que sobrar no fim
+// do buffer fica guardado e é completado pelo próximo read()
+#define BATCH_BYTES 65536 // múltiplo de sizeof(AppMsg) e sizeof(IRQMsg)
+
+typedef struct {
+    char data[BATCH_BYTES];
+    int len; // bytes já lidos de uma mensagem parcial
+} MsgBatch;
+
+MsgBatch sys_batch, irq_batch;
+
+static void on_app_bytes(char *p){
+    AppMsg am;
+    memcpy(&am, p, sizeof(am));
+    handle_app_msg(&am);
+}
+
+static void on_irq_bytes(char *p){
+    IRQMsg im;
+    memcpy(&im, p, sizeof(im));
+    handle_irq_msg(&im);
+}
+
+void drain_batched(int fd, MsgBatch *b, int msg_size, void (*handle)(char *), char *what){
+    while(1){
+        int space = BATCH_BYTES - b->len;
+        int n = read(fd, b->data + b->len, space);
+        if(n < 0){
+            if(errno==EAGAIN || errno==EWOULDBLOCK) // se o read falhou pq nao tem mais nada pra ler(pipe vazio), volta pro loop principal do kernel
+                break;
+            printf("Erro na leitura do pipe de %s\n", what); // aqui, é necessário que a estrutura e funcionamento do pipe esteja quebrada
+            break;
+        }
+        if(n == 0) // se o escritor fechou, volta para o loop principal.
+            break;
+        b->len += n;
+        int off = 0;
+        while(b->len - off >= msg_size){ // todas as mensagens completas do lote
+            handle(b->data + off);
+            off += msg_size;
+        }
+        memmove(b->data, b->data + off, b->len - off); // guarda a mensagem parcial
+        b->len -= off;
+        if(n < space) // o pipe foi esvaziado: não precisa de outro read() só para receber EAGAIN
+            break;
+    }
+    kernel_dispatch();
+}
+
+// 1) Mensagens de Apps (syscalls / terminated)
+void drain_sys_pipe(){
+    drain_batched(sys_pipe[0], &sys_batch, sizeof(AppMsg), on_app_bytes, "syscall");
+}
+
+#ifdef __linux__
+// Cria o anel compartilhado com espaço para algumas mensagens por app e a campainha
+int shm_ring_open(int nprocs){
+    unsigned cap = 1024;
+    while(cap < (unsigned)nprocs * 4)
+        cap <<= 1;
+    size_t bytes = sizeof(ShmRing) + cap * sizeof(RingSlot);
+    shm_ring = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(shm_ring == MAP_FAILED)
+        return -1;
+    atomic_init(&shm_ring->tail, 0);
+    shm_ring->head = 0;
+    atomic_init(&shm_ring->sleeping, 0);
+    shm_ring->mask = cap - 1;
+    for(unsigned i=0;i<cap;i++)
+        atomic_init(&shm_ring->slots[i].seq, i);
+    shm_doorbell = eventfd(0, EFD_NONBLOCK);
+    if(shm_doorbell < 0)
+        return -1;
+    return 0;
+}
+
+// Consome tudo que estiver publicado no anel, sem syscalls por mensagem
+void drain_shm_ring(int doorbell_rang){
+    ShmRing *r = shm_ring;
+    if(doorbell_rang){ // zera a campainha só quando algum app de fato tocou
+        uint64_t cnt;
+        read(shm_doorbell, &cnt, sizeof(cnt));
+    }
+    atomic_store(&r->sleeping, 0);
+    while(1){
+        RingSlot *slot = &r->slots[r->head & r->mask];
+        unsigned seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if(seq != r->head + 1) // vazio (ou produtor ainda publicando este slot)
+            break;
+        AppMsg am = slot->msg;
+        atomic_store_explicit(&slot->seq, r->head + r->mask + 1, memory_order_release); // libera o slot para a próxima volta
+        r->head++;
+        handle_app_msg(&am);
+    }
+    kernel_dispatch();
+}
+
+// Chamada antes de bloquear: anuncia que o kernel vai dormir e confere de novo o anel.
+// Retorna true se já há mensagem (o loop não deve bloquear).
+int shm_arm_doorbell(){
+    atomic_store(&shm_ring->sleeping, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    RingSlot *slot = &shm_ring->slots[shm_ring->head & shm_ring->mask];
+    if(atomic_load_explicit(&slot->seq, memory_order_acquire) == shm_ring->head + 1){
+        atomic_store(&shm_ring->sleeping, 0);
+        return true;
+    }
+    return false;
+}
+#endif
+
+// Mensagens de apps do transporte configurado; fd_ready indica se o sys_fd acordou o loop
+void drain_sys(int fd_ready){
+#ifdef __linux__
+    if(transport == TRANSPORT_SHM){ // o anel é sempre conferido, mesmo quando quem acordou foi uma IRQ
+        drain_shm_ring(fd_ready);
+        return;
+    }
+#endif
+    if(fd_ready)
+        drain_sys_pipe();
+}
+
+// Antes de bloquear o loop: true se há mensagens de apps pendentes que não acordariam o sys_fd
+int sys_pending(){
+#ifdef __linux__
+    if(transport == TRANSPORT_SHM)
+        return shm_arm_doorbell();
+#endif
+    return false;
+}
+
+// 2) Mensagens de IRQ (IRQ0/1/2)
+void drain_irq_pipe(){
+    drain_batched(irq_pipe[0], &irq_batch, sizeof(IRQMsg), on_irq_bytes, "IRQs");
+}
+
+#ifdef __linux__
+// Cria o timerfd periódico que substitui o InterController: os prazos são absolutos
+// (início + k*timeslice_ms), então atrasos do kernel não se acumulam no quantum seguinte
+int timer_open(){
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if(fd < 0)
+        return -1;
+    struct itimerspec its;
+    clock_gettime(CLOCK_MONOTONIC, &its.it_value);
+    its.it_value.tv_sec += timeslice_ms / 1000;
+    its.it_value.tv_nsec += (timeslice_ms % 1000) * 1000000L;
+    if(its.it_value.tv_nsec >= 1000000000L){
+        its.it_value.tv_sec++;
+        its.it_value.tv_nsec -= 1000000000L;
+    }
+    its.it_interval.tv_sec = timeslice_ms / 1000;
+    its.it_interval.tv_nsec = (timeslice_ms % 1000) * 1000000L;
+    if(timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, NULL) < 0){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Cada expiração do timer é um IRQ0; as IRQs de dispositivo são sorteadas como no InterController
+void drain_timerfd(){
+    uint64_t expirations;
+    if(read(irq_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        return;
+    for(uint64_t e=0;e<expirations;e++){
+        IRQMsg m;
+        m.type = IRQ_TIMESLICE;
+        for(m.cpu=0;m.cpu<num_cpus;m.cpu++)
+            handle_irq_msg(&m);
+        m.cpu = 0;
+        if(io_model) // com -D as IRQs de dispositivo vêm do modelo de serviço
+            continue;
+        if(rng_range(&kernel_rng, 100) < p1_prob){
+            m.type = IRQ_IO_D1;
+            handle_irq_msg(&m);
+        }
+        if(rng_range(&kernel_rng, 100) < p2_prob){
+            m.type = IRQ_IO_D2;
+            handle_irq_msg(&m);
+        }
+    }
+    kernel_dispatch();
+}
+
+// Modo real: entrega os términos já vencidos e rearma o timerfd para o próximo
+void drain_io_timer(){
+    uint64_t expirations;
+    if(read(io_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+        return;
+    long long t = now_ns();
+    while(io_inflight.size > 0 && io_inflight.it[0].key <= t)
+        io_complete(key_heap_pop(&io_inflight).idx);
+    io_timer_arm();
+    kernel_dispatch();
+}
+#endif
+
+// Trata as IRQs pendentes da origem configurada
+void drain_irqs(){
+#ifdef __linux__
+    if(timer_source == TIMER_TIMERFD){
+        drain_timerfd();
+        return;
+    }
+#endif
+    drain_irq_pipe();
+}
+
+//Recolhe apps que já estão terminated
+void reap_children(){
+    while(1){
+        int status;
+        int w = waitpid(-1, &status, WNOHANG); // espera qualquer filho terminar. se ninguém terminou, não bloquear o kernel (WNOHANG)
+        if(w <= 0) 
+            break;
+    }
+}
+
+// Verifica se todos os apps terminaram; nesse caso encerra o IC
+int kernel_finished(){
+    if(arrival_rate > 0 && !open_done())
+        return false;
+    if(pt.count[TERMINATED] >= num_procs_app){
+        printf("[Kernel] Todos os apps terminaram.\n");
+        // Encerra IC (se existir) e sai
+        if(ic_pid > 0){
+            kill(ic_pid, SIGKILL);
+            waitpid(ic_pid, NULL, 0);
+        }
+        return true;
+    }
+    return false;
+}
+
+// Loop do kernel com select(): reconstrói o fd_set a cada iteração e recolhe filhos após cada acordada
+void loop_select(){
+    fd_set rds; // estrutura usada por select() para indicarmos quais file descriptors (pipes) queremos monitorar 
+    int nfds = (irq_fd > sys_fd ? irq_fd : sys_fd) + 1; // define o maior numero de descritor que queremos avaliar + 1
+    if(io_fd >= nfds)
+        nfds = io_fd + 1;
+
+    while(1){
+        if(kernel_finished())
+            break;
+
+        if(got_sigint){
+            got_sigint = 0;
+            print_status_table();
+            pause();
+        }
+
+        FD_ZERO(&rds); 
+        FD_SET(irq_fd, &rds); // coloca os pipes dentro da estrutura de seleção
+        FD_SET(sys_fd, &rds);
+        if(io_fd >= 0)
+            FD_SET(io_fd, &rds);
+
+        // Espera algo chegar (IRQ0/1/2 ou SYSCALL/TERM); não bloqueia se o anel compartilhado já tem mensagens
+        struct timeval zero = {0, 0};
+        int rv = select(nfds, &rds, NULL, NULL, sys_pending() ? &zero : NULL); // o select ordena o kernel a esperar até que possua alguma mensagem em algum dos pipes definidos com FD_SET para ler. enquanto isso, o kernel "dorme"
+        if(rv < 0){ // se o tempo de espera acabou e nada ficou pronto
+            if(errno == EINTR) // se ele foi interrompido por um sinal (como Ctrl+C, apenas passa a próxima iteração do loop)
+                continue;
+            printf("Erro na leitura dos pipes\n");
+            break;
+        }
+        kernel_wakeups++;
+
+        drain_sys(FD_ISSET(sys_fd, &rds)); // verifica se alguma mensagem no pipe de syscall foi enviada
+
+        if(FD_ISSET(irq_fd, &rds)) //verifica se o pipe de leitura de irq do kernel possui algum conteúdo
+            drain_irqs();
+
+        if(io_fd >= 0 && FD_ISSET(io_fd, &rds))
+            drain_io_timer();
+
+        reap_children();
+    }
+}
+
+#ifdef __linux__
+// Loop do kernel com epoll + signalfd: os pipes ficam registrados uma única vez, SIGINT/SIGCHLD chegam
+// como leituras em um descritor e os filhos só são recolhidos quando chega um SIGCHLD de término
+void loop_epoll(){
+    // SA_NOCLDSTOP: não gera SIGCHLD quando um app é parado por SIGSTOP (isso acontece a cada troca)
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sigusr1_handler;
+    sa.sa_flags = SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &sa, NULL);
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGCHLD);
+    sigaddset(&mask, SIGUSR1);
+    sigaddset(&mask, SIGCONT);
+    sigprocmask(SIG_BLOCK, &mask, NULL); // sinais bloqueados passam a ser lidos pelo signalfd
+
+    int sfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if(sfd < 0 || ep < 0){
+        printf("Erro na criação do epoll/signalfd\n");
+        return;
+    }
+    int fds[4] = { sys_fd, irq_fd, sfd, io_fd };
+    for(int i=0;i<(io_fd >= 0 ? 4 : 3);i++){
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = fds[i];
+        epoll_ctl(ep, EPOLL_CTL_ADD, fds[i], &ev);
+    }
+
+    reap_children(); // algum filho pode ter terminado antes do bloqueio dos sinais
+
+    struct epoll_event evs[4];
+    while(1){
+        if(kernel_finished())
+            break;
+
+        int rv = epoll_wait(ep, evs, 4, sys_pending() ? 0 : -1);
+        if(rv < 0){
+            if(errno == EINTR)
+                continue;
+            printf("Erro na leitura dos pipes\n");
+            break;
+        }
+        kernel_wakeups++;
+
+        int sys_ready = false, irq_ready = false, sig_ready = false, io_ready = false;
+        for(int i=0;i<rv;i++){
+            if(evs[i].data.fd == sys_fd)
+                sys_ready = true;
+            else if(evs[i].data.fd == irq_fd)
+                irq_ready = true;
+            else if(evs[i].data.fd == io_fd)
+                io_ready = true;
+            else
+                sig_ready = true;
+        }
+
+        // mesma ordem do loop com select: syscalls, depois IRQs
+        drain_sys(sys_ready);
+        if(irq_ready)
+            drain_irqs();
+        if(io_ready)
+            drain_io_timer();
+
+        if(sig_ready){
+            struct signalfd_siginfo si;
+            int got_chld = false;
+            while(read(sfd, &si, sizeof(si)) == sizeof(si)){
+                if(si.ssi_signo == SIGINT)
+                    got_sigint = 1;
+                else if(si.ssi_signo == SIGCHLD)
+                    got_chld = true;
+            }
+            if(got_chld)
+                reap_children();
+        }
+
+        if(got_sigint){
+            got_sigint = 0;
+            print_status_table();
+            // equivalente ao pause(): espera SIGINT/SIGUSR1/SIGCONT, recolhendo filhos enquanto isso
+            while(sigwaitinfo(&mask, NULL) == SIGCHLD)
+                reap_children();
+        }
+    }
+
+    close(ep);
+    close(sfd);
+    sigprocmask(SIG_UNBLOCK, &mask, NULL);
+}
+#endif
+
+// --------------- Workload (replay de traces) ---------------
+// Arquivo de texto mapeado com mmap e lido sob demanda: cada app tem um cursor para a sua seção e as
+// IRQs de dispositivo têm outro, então nada do trace é copiado para a memória além da linha atual.
+// Tempos em microssegundos; linhas vazias e comentários (#) são ignorados.
+//
+//   proc CHEGADA        início da seção de um app (chega no instante CHEGADA)
+//   cpu DURAÇÃO         rajada de CPU; ao fim dela o PC avança
+//   sys D1|D2 READ|WRITE|EXEC   syscall: o app bloqueia no dispositivo
+//   irq D1|D2 INSTANTE  término de E/S no dispositivo (IRQ1/IRQ2); em ordem crescente no arquivo
+//
+// O app termina no fim da sua seção (próximo proc ou fim do arquivo).
+typedef enum {
+    WL_NONE = 0,
+    WL_PROC = 1,
+    WL_CPU = 2,
+    WL_SYS = 3,
+    WL_IRQ = 4
+} WlKind;
+
+typedef struct {
+    int kind; // WlKind
+    long long us; // CHEGADA, DURAÇÃO ou INSTANTE
+    int dev;
+    int op;
+} WlLine;
+
+typedef struct {
+    const char *base, *end; // arquivo mapeado
+    size_t size;
+    const char **proc_cur; // cursor de cada app (logo depois da sua linha proc)
+    long long *arrival_ns;
+    const char *irq_cur; // cursor das IRQs de dispositivo
+    long long last_irq_ns;
+} Workload;
+
+char *workload_path = NULL; // -w
+Workload wl;
+
+static void wl_error(const char *at, const char *what){
+    printf("Workload inválido em %s (byte %ld): %s\n", workload_path, (long)(at - wl.base), what);
+    exit(1);
+}
+
+static const char *wl_skip_blank(const char *p){
+    while(p < wl.end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    return p;
+}
+
+static int wl_word(const char **pp, const char *w){
+    const char *p = wl_skip_blank(*pp);
+    size_t n = strlen(w);
+    if((size_t)(wl.end - p) < n || memcmp(p, w, n) != 0)
+        return false;
+    if(p + n < wl.end && p[n] != ' ' && p[n] != '\t' && p[n] != '\r' && p[n] != '\n')
+        return false;
+    *pp = p + n;
+    return true;
+}
+
+static long long wl_number(const char **pp){
+    const char *p = wl_skip_blank(*pp);
+    if(p >= wl.end || *p < '0' || *p > '9')
+        wl_error(p, "número esperado");
+    long long v = 0;
+    while(p < wl.end && *p >= '0' && *p <= '9')
+        v = v * 10 + (*p++ - '0');
+    *pp = p;
+    return v;
+}
+
+static int wl_device(const char **pp){
+    for(int d=0;d<num_devices;d++){
+        if(wl_word(pp, dev_str(d)))
+            return d;
+    }
+    wl_error(*pp, "dispositivo esperado (D1..Dn, conforme os -D)");
+    return -1;
+}
+
+// Lê a próxima linha útil a partir de *pp; WL_NONE no fim do arquivo
+static WlLine wl_next(const char **pp){
+    WlLine l = { WL_NONE, 0, -1, -1 };
+    const char *p = *pp;
+    while(p < wl.end){
+        p = wl_skip_blank(p);
+        const char *start = p;
+        if(p < wl.end && *p != '\n' && *p != '#'){
+            if(wl_word(&p, "proc")){
+                l.kind = WL_PROC;
+                l.us = wl_number(&p);
+            } else if(wl_word(&p, "cpu")){
+                l.kind = WL_CPU;
+                l.us = wl_number(&p);
+            } else if(wl_word(&p, "sys")){
+                l.kind = WL_SYS;
+                l.dev = wl_device(&p);
+                if(wl_word(&p, "READ"))
+                    l.op = OP_READ;
+                else if(wl_word(&p, "WRITE"))
+                    l.op = OP_WRITE;
+                else if(wl_word(&p, "EXEC"))
+                    l.op = OP_EXEC;
+                else
+                    wl_error(p, "operação esperada (READ, WRITE ou EXEC)");
+            } else if(wl_word(&p, "irq")){
+                l.kind = WL_IRQ;
+                l.dev = wl_device(&p);
+                l.us = wl_number(&p);
+            } else {
+                wl_error(start, "linha desconhecida");
+            }
+            p = wl_skip_blank(p);
+            if(p < wl.end && *p != '\n' && *p != '#')
+                wl_error(p, "sobra no fim da linha");
+        }
+        while(p < wl.end && *p != '\n') // resto da linha (comentário)
+            p++;
+        if(p < wl.end)
+            p++;
+        if(l.kind != WL_NONE)
+            break;
+    }
+    *pp = p;
+    return l;
+}
+
+// Mapeia o arquivo e faz uma única passada para achar o início de cada app; define num_procs_app
+void workload_open(){
+    int fd = open(workload_path, O_RDONLY);
+    if(fd < 0){
+        printf("Erro ao abrir o workload %s: %s\n", workload_path, strerror(errno));
+        exit(1);
+    }
+    struct stat st;
+    if(fstat(fd, &st) < 0 || st.st_size == 0){
+        printf("Workload vazio ou ilegível: %s\n", workload_path);
+        exit(1);
+    }
+    wl.size = st.st_size;
+    wl.base = mmap(NULL, wl.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(wl.base == MAP_FAILED){
+        printf("Erro no mmap do workload\n");
+        exit(1);
+    }
+    wl.end = wl.base + wl.size;
+
+    int n = 0, cap = 64;
+    wl.proc_cur = malloc(cap * sizeof(char *));
+    wl.arrival_ns = malloc(cap * sizeof(long long));
+    const char *p = wl.base;
+    while(1){
+        WlLine l = wl_next(&p);
+        if(l.kind == WL_NONE)
+            break;
+        if(l.kind != WL_PROC){
+            if(n == 0 && l.kind != WL_IRQ)
+                wl_error(p, "cpu/sys antes do primeiro proc");
+            continue;
+        }
+        if(n == cap){
+            cap *= 2;
+            wl.proc_cur = realloc(wl.proc_cur, cap * sizeof(char *));
+            wl.arrival_ns = realloc(wl.arrival_ns, cap * sizeof(long long));
+        }
+        if(wl.proc_cur == NULL || wl.arrival_ns == NULL){
+            printf("Erro na alocação do índice do workload\n");
+            exit(1);
+        }
+        wl.proc_cur[n] = p;
+        wl.arrival_ns[n] = l.us * 1000;
+        n++;
+    }
+    if(n == 0){
+        printf("Workload sem nenhum proc: %s\n", workload_path);
+        exit(1);
+    }
+    wl.irq_cur = wl.base;
+    wl.last_irq_ns = 0;
+    num_procs_app = n;
+}
+
+// Próxima ação do app idx (cpu, sys ou WL_NONE = terminou), pulando as linhas irq
+WlLine workload_next_action(int idx){
+    while(1){
+        const char *p = wl.proc_cur[idx];
+        WlLine l = wl_next(&p);
+        if(l.kind == WL_PROC || l.kind == WL_NONE){ // fim da seção: não avança o cursor
+            l.kind = WL_NONE;
+            return l;
+        }
+        wl.proc_cur[idx] = p;
+        if(l.kind != WL_IRQ)
+            return l;
+    }
+}
+
+// Próxima IRQ de dispositivo do workload; WL_NONE quando acabaram
+WlLine workload_next_irq(){
+    while(1){
+        WlLine l = wl_next(&wl.irq_cur);
+        if(l.kind == WL_NONE || l.kind == WL_IRQ){
+            if(l.kind == WL_IRQ){
+                if(l.us * 1000 < wl.last_irq_ns)
+                    wl_error(wl.irq_cur, "irq fora de ordem");
+                wl.last_irq_ns = l.us * 1000;
+            }
+            return l;
+        }
+    }
+}
+
+// --------------- Motor de eventos discretos (tempo virtual) ---------------
+// Kernel, InterController e apps viram eventos numa fila de prioridade ordenada pelo tempo virtual.
+// Os handlers do kernel (handle_app_msg/handle_irq_msg/switch_to) são os mesmos do modo real;
+// só o transporte muda: as mensagens são entregues por chamada direta no instante do evento.
+#define DES_VPID_BASE 100 // PIDs virtuais começam aqui
+
+typedef enum {
+    EV_TICK = 0, // IRQ0 do InterController (seguido das IRQ1/IRQ2 sorteadas)
+    EV_APP_STEP = 1, // app terminou uma iteração de CPU
+    EV_ARRIVAL = 2, // app do workload chega (-w)
+    EV_IRQ = 3, // término de E/S do workload no dispositivo idx (-w)
+    EV_IO_DONE = 4, // término do pedido de E/S do app idx (-D)
+    EV_OPEN_ARRIVAL = 5 // chegada no sistema aberto (-r)
+} EventType;
+
+typedef struct {
+    long long t; // instante virtual (ns)
+    unsigned long long seq; // desempate FIFO entre eventos no mesmo instante
+    int type; // EventType
+    int idx; // índice do app (EV_APP_STEP, EV_ARRIVAL, EV_IO_DONE) ou dispositivo (EV_IRQ)
+    unsigned gen; // geração do app quando o evento foi criado; eventos antigos são descartados
+} Event;
+
+// Heap binário de mínimo por (t, seq)
+typedef struct {
+    Event *ev;
+    int size, cap;
+    unsigned long long next_seq;
+} EventHeap;
+
+typedef struct {
+    long long remaining; // CPU que falta para terminar a iteração atual (ns)
+    long long run_start; // instante em que recebeu a CPU pela última vez
+    unsigned gen; // incrementada a cada parada: invalida o EV_APP_STEP pendente
+    int pc;
+    Rng rng; // sorteios do app (syscall, dispositivo, operação)
+    int in_burst; // workload: remaining é uma rajada de CPU (ao fim dela o PC avança)
+} DesApp;
+
+EventHeap des_heap;
+DesApp *des_app;
+long des_events = 0; // eventos processados
+long des_ticks = 0; // timeslices (IRQ0) simulados
+
+static int ev_less(Event *a, Event *b){
+    if(a->t != b->t)
+        return a->t < b->t;
+    return a->seq < b->seq;
+}
+
+void heap_push(EventHeap *h, long long t, int type, int idx, unsigned gen){
+    if(h->size == h->cap){
+        h->cap = h->cap ? h->cap * 2 : 64;
+        h->ev = realloc(h->ev, h->cap * sizeof(Event));
+        if(h->ev == NULL){
+            printf("Erro na alocação da fila de eventos\n");
+            exit(1);
+        }
+    }
+    Event e = { t, h->next_seq++, type, idx, gen };
+    int i = h->size++;
+    while(i > 0){ // sobe enquanto for menor que o pai
+        int parent = (i - 1) / 2;
+        if(!ev_less(&e, &h->ev[parent]))
+            break;
+        h->ev[i] = h->ev[parent];
+        i = parent;
+    }
+    h->ev[i] = e;
+}
+
+Event heap_pop(EventHeap *h){
+    Event top = h->ev[0];
+    Event last = h->ev[--h->size];
+    int i = 0;
+    while(1){ // desce o último elemento a partir da raiz
+        int c = 2 * i + 1;
+        if(c >= h->size)
+            break;
+        if(c + 1 < h->size && ev_less(&h->ev[c + 1], &h->ev[c]))
+            c++;
+        if(!ev_less(&h->ev[c], &last))
+            break;
+        h->ev[i] = h->ev[c];
+        i = c;
+    }
+    if(h->size > 0)
+        h->ev[i] = last;
+    return top;
+}
+
+void des_app_resume(int idx){
+    DesApp *a = &des_app[idx];
+    a->run_start = des_now;
+    a->gen++;
+    heap_push(&des_heap, des_now + a->remaining, EV_APP_STEP, idx, a->gen);
+}
+
+void fiber_start(int idx);
+
+// Slot reaproveitado por um app novo do sistema aberto; gen++ descarta eventos do app anterior
+void des_app_reset(int idx, int serial){
+    DesApp *a = &des_app[idx];
+    a->remaining = APP_STEP_MS * 1000000LL;
+    a->pc = 0;
+    a->in_burst = false;
+    a->gen++;
+    rng_seed(&a->rng, sim_seed ^ ((unsigned long long)serial << 32));
+    if(app_fibers)
+        fiber_start(idx); // a fibra do app anterior terminou: recomeça o código do app do início
+}
+
+void des_app_stop(int idx){
+    DesApp *a = &des_app[idx];
+    a->remaining -= des_now - a->run_start; // guarda o quanto falta da iteração interrompida
+    a->gen++;
+}
+
+// Comportamento do app virtual, comum a -e des e -e fiber (mesmo sorteio de app_process()): no fim de
+// uma iteração de CPU preenche m com a syscall ou com o avanço do PC; true se o app terminou
+int des_app_iteration(int idx, AppMsg *m){
+    DesApp *a = &des_app[idx];
+    m->pid = pt.pid[idx];
+    if(rng_range(&a->rng, 100) < prob_syscall){
+        m->type = APP_SYSCALL;
+        m->device = rng_range(&a->rng, num_devices);
+        m->op = rng_range(&a->rng, 3);
+        return false;
+    }
+    a->pc++;
+    m->type = APP_PROGRESS;
+    m->device = -1;
+    m->op = a->pc;
+    return a->pc >= max_iterations;
+}
+
+// Mensagem de término do app idx
+void des_app_exit_msg(int idx, AppMsg *m){
+    m->type = APP_TERMINATED;
+    m->pid = pt.pid[idx];
+    m->device = -1;
+    m->op = -1;
+}
+
+// Fim de uma iteração do app (evento): entrega as mensagens e, se ele segue com a CPU, agenda a próxima
+void des_app_step(int idx){
+    DesApp *a = &des_app[idx];
+    AppMsg msg;
+    a->remaining = APP_STEP_MS * 1000000LL;
+
+    int done = des_app_iteration(idx, &msg);
+    if(msg.type == APP_SYSCALL)
+        a->gen++; // o app se para depois da syscall; o kernel decide quando volta
+    handle_app_msg(&msg);
+    if(msg.type == APP_SYSCALL)
+        return;
+    if(done){
+        des_app_exit_msg(idx, &msg);
+        a->gen++;
+        handle_app_msg(&msg);
+        return;
+    }
+    // continua com a CPU: próxima iteração
+    a->run_start = des_now;
+    heap_push(&des_heap, des_now + a->remaining, EV_APP_STEP, idx, a->gen);
+}
+
+// --------------- Apps como fibras (-e fiber) ---------------
+// Cada app executa como um laço de verdade numa fibra (ucontext) dentro do processo do kernel, com
+// pilha pequena e sem processo, pipe nem sinal. O que o app faz em cada iteração é des_app_iteration,
+// o mesmo código do evento EV_APP_STEP de -e des. A fibra só devolve o controle ao kernel em dois
+// pontos: ao pedir CPU (fiber_cpu: volta quando o app recebeu essa CPU em tempo virtual; sem a CPU,
+// o app fica parado ali, que é a preempção cooperativa no fim do timeslice) e ao mandar uma mensagem
+// (fiber_send: o kernel chama handle_app_msg na própria pilha e continua a fibra). Os sorteios usam
+// o mesmo Rng do app virtual, então -e fiber reproduz exatamente a simulação de -e des.
+#define FIBER_STACK (16 * 1024) // pilha de cada fibra; só as páginas tocadas ocupam memória
+
+typedef enum {
+    FIBER_CPU = 0, // quer req_ns de CPU antes de continuar
+    FIBER_MSG = 1, // mandou req_msg ao kernel
+    FIBER_EXIT = 2 // o código do app terminou
+} FiberReq;
+
+ucontext_t *fiber_ctx; // contexto de cada app
+char *fiber_stacks; // uma região só (MAP_NORESERVE) com as pilhas de todos os apps
+ucontext_t fiber_kernel; // contexto do laço de eventos
+int fiber_req; // FiberReq da última volta ao kernel
+long long fiber_req_ns;
+AppMsg fiber_req_msg;
+long fiber_switches = 0; // voltas kernel -> fibra
+
+// Devolve o controle ao kernel com o pedido já preenchido
+static void fiber_yield(int idx){
+    swapcontext(&fiber_ctx[idx], &fiber_kernel);
+}
+
+static void fiber_cpu(int idx, long long ns){
+    fiber_req = FIBER_CPU;
+    fiber_req_ns = ns;
+    fiber_yield(idx);
+}
+
+static void fiber_send(int idx, AppMsg *m){
+    fiber_req = FIBER_MSG;
+    fiber_req_msg = *m;
+    fiber_yield(idx);
+}
+
+// Laço do app na fibra; pc e sorteios ficam em des_app para sobreviver à fibra.
+// resumed: fibra recriada de um checkpoint, já parada no pedido de CPU da iteração atual
+static void fiber_app(int idx, int resumed){
+    AppMsg msg;
+    int done = false;
+    while(!done){
+        if(!resumed)
+            fiber_cpu(idx, APP_STEP_MS * 1000000LL); // 1 seg de CPU
+        resumed = false;
+        done = des_app_iteration(idx, &msg);
+        fiber_send(idx, &msg); // syscall: o kernel o bloqueia; a próxima CPU só vem depois do desbloqueio
+    }
+    des_app_exit_msg(idx, &msg);
+    fiber_send(idx, &msg);
+    fiber_req = FIBER_EXIT; // uc_link volta ao kernel
+}
+
+// Continua a fibra de idx até ela pedir CPU ou terminar, entregando as mensagens no caminho
+void fiber_run(int idx){
+    DesApp *a = &des_app[idx];
+    while(1){
+        fiber_switches++;
+        swapcontext(&fiber_kernel, &fiber_ctx[idx]);
+        if(fiber_req == FIBER_EXIT)
+            return;
+        if(fiber_req == FIBER_CPU){
+            a->remaining = fiber_req_ns;
+            if(pt.state[idx] == RUNNING){ // ainda tem a CPU: segue executando
+                a->run_start = des_now;
+                heap_push(&des_heap, des_now + a->remaining, EV_APP_STEP, idx, a->gen);
+            }
+            return; // sem a CPU, des_app_resume agenda o resto quando ela voltar
+        }
+        if(fiber_req_msg.type != APP_PROGRESS)
+            a->gen++; // o app se para depois da syscall ou do término; o kernel decide quando volta
+        handle_app_msg(&fiber_req_msg);
+    }
+}
+
+void fiber_make(int idx, int resumed){
+    ucontext_t *u = &fiber_ctx[idx];
+    getcontext(u);
+    u->uc_stack.ss_sp = fiber_stacks + (size_t)idx * FIBER_STACK;
+    u->uc_stack.ss_size = FIBER_STACK;
+    u->uc_link = &fiber_kernel;
+    makecontext(u, (void (*)(void))fiber_app, 2, idx, resumed);
+}
+
+// (Re)cria a fibra de idx e a executa até o primeiro pedido de CPU
+void fiber_start(int idx){
+    fiber_make(idx, false);
+    fiber_run(idx);
+}
+
+void fibers_init(){
+    fiber_ctx = calloc(num_procs_app, sizeof(ucontext_t));
+    fiber_stacks = mmap(NULL, (size_t)num_procs_app * FIBER_STACK, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(fiber_ctx == NULL || fiber_stacks == MAP_FAILED){
+        printf("Erro na alocação das fibras\n");
+        exit(1);
+    }
+}
+
+void print_fibers(){
+    if(!app_fibers)
+        return;
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    printf("[Fibras] %d apps | pilha de %d KB | %ld retomadas | memória máxima do processo %.1f MB (%.1f KB por app)\n",
+           num_procs_app, FIBER_STACK / 1024, fiber_switches, ru.ru_maxrss / 1024.0, (double)ru.ru_maxrss / num_procs_app);
+}
+
+// Fim da rajada atual de um app do workload: avança o PC e segue para a próxima ação do seu trace
+void des_wl_step(int idx){
+    DesApp *a = &des_app[idx];
+    AppMsg msg;
+    msg.pid = pt.pid[idx];
+    msg.device = -1;
+    if(a->in_burst){
+        a->pc++;
+        msg.type = APP_PROGRESS;
+        msg.op = a->pc;
+        handle_app_msg(&msg);
+    }
+    WlLine l = workload_next_action(idx);
+    if(l.kind == WL_CPU){
+        a->in_burst = true;
+        a->remaining = l.us * 1000;
+        a->run_start = des_now;
+        heap_push(&des_heap, des_now + a->remaining, EV_APP_STEP, idx, a->gen);
+        return;
+    }
+    a->in_burst = false;
+    a->remaining = 0;
+    a->gen++; // syscall ou fim: o app se para
+    if(l.kind == WL_SYS){
+        msg.type = APP_SYSCALL;
+        msg.device = l.dev;
+        msg.op = l.op;
+    } else {
+        msg.type = APP_TERMINATED;
+        msg.op = -1;
+    }
+    handle_app_msg(&msg);
+}
+
+int wl_arrived = 0; // apps do workload que já chegaram
+int wl_irqs_done = false; // acabaram as linhas irq do workload
+
+// Agenda a próxima IRQ de dispositivo do workload
+void des_wl_push_irq(){
+    WlLine l = workload_next_irq();
+    if(l.kind == WL_IRQ)
+        heap_push(&des_heap, l.us * 1000, EV_IRQ, l.dev, 0);
+    else
+        wl_irqs_done = true;
+}
+
+// Sem IRQs futuras, apps bloqueados nunca mais voltariam: a simulação não termina
+int des_wl_stuck(){
+    return wl_irqs_done && wl_arrived == num_procs_app &&
+           pt.count[TERMINATED] + devices_blocked() == num_procs_app;
+}
+
+void des_push_io(long long t, int idx){
+    heap_push(&des_heap, t, EV_IO_DONE, idx, 0);
+}
+
+// IRQ0 (uma por CPU) e, com as mesmas probabilidades do InterController, IRQ1/IRQ2
+// (com -w as IRQs de dispositivo vêm do workload; com -D, do modelo de serviço)
+void des_tick(){
+    IRQMsg m;
+    des_ticks++;
+    m.type = IRQ_TIMESLICE;
+    for(m.cpu=0;m.cpu<num_cpus;m.cpu++)
+        handle_irq_msg(&m);
+    m.cpu = 0;
+    heap_push(&des_heap, des_now + timeslice_ms * 1000000LL, EV_TICK, -1, 0);
+    if(workload_path || io_model)
+        return;
+    if(rng_range(&kernel_rng, 100) < p1_prob){
+        m.type = IRQ_IO_D1;
+        handle_irq_msg(&m);
+    }
+    if(rng_range(&kernel_rng, 100) < p2_prob){
+        m.type = IRQ_IO_D2;
+        handle_irq_msg(&m);
+    }
+}
+
+// --------------- Verificação de invariantes (-C) ---------------
+// Depois de cada lote confere a tabela contra as estruturas do kernel: bitmaps e contadores batem com
+// os estados, cada RUNNING é o atual de exatamente uma CPU, cada READY está exatamente uma vez nas
+// estruturas de prontos (e nenhum outro está nelas) e cada BLOCKED está na fila de um único
+// dispositivo. No fim, todos os apps precisam ter terminado. O(apps) por lote: é para testes.
+// No modo real o lote inclui mensagens que cruzaram com a preempção (syscall de um app já na fila).
+// Um app do workload que ainda não chegou (sem PID) está READY desde pcb_init e fica fora das filas.
+int *check_seen; // aparições de cada app nas estruturas visitadas
+long check_batches = 0;
+
+static void check_fail(const char *what, int idx){
+    printf("[Check] %s: app %d (%s) em %.3f s, lote %ld\n", what, idx, idx >= 0 ? pt.stats[idx].name : "-",
+           now_ns() / 1e9, check_batches);
+    exit(1);
+}
+
+static void check_visit(int idx){
+    if(idx < 0 || idx >= num_procs_app)
+        check_fail("PID desconhecido numa fila", idx);
+    check_seen[idx]++;
+}
+static void check_visit_pid(pid_t p){
+    check_visit(app_index_from_pid(p));
+}
+
+void check_invariants(){
+    int n = num_procs_app;
+    check_batches++;
+    if(check_seen == NULL && (check_seen = malloc(n * sizeof(int))) == NULL){
+        printf("Erro na alocação da verificação\n");
+        exit(1);
+    }
+
+    int count[NUM_STATES] = {0};
+    for(int i=0;i<n;i++){
+        count[pt.state[i]]++;
+        for(int st=0;st<NUM_STATES;st++)
+            if(((pt.state_bits[st][i >> 6] >> (i & 63)) & 1) != (pt.state[i] == st))
+                check_fail("bitmap de estado diverge do estado", i);
+    }
+    for(int st=0;st<NUM_STATES;st++)
+        if(count[st] != pt.count[st])
+            check_fail("contador de estado diverge da tabela", -1);
+
+    memset(check_seen, 0, n * sizeof(int));
+    for(int c=0;c<num_cpus;c++){
+        if(cpus[c].current_pid <= 0)
+            continue;
+        int idx = app_index_from_pid(cpus[c].current_pid);
+        check_visit(idx);
+        if(pt.state[idx] != RUNNING || pt.cpu[idx] != c)
+            check_fail("atual da CPU não está executando nela", idx);
+    }
+    for(int i=0;i<n;i++)
+        if((pt.state[i] == RUNNING) != (check_seen[i] == 1))
+            check_fail(check_seen[i] > 1 ? "app atual de duas CPUs" : "app RUNNING sem CPU", i);
+
+    memset(check_seen, 0, n * sizeof(int));
+    int ready = 0;
+    for(int c=0;c<num_cpus;c++){
+        sched->each(&cpus[c], check_visit);
+        ready += sched->ready_count(&cpus[c]);
+        steal_movable = 0;
+        sched->each(&cpus[c], steal_visit);
+        if(steal_movable != cpus[c].movable)
+            check_fail("contador de prontos não fixados diverge da CPU", -1);
+    }
+    for(int i=0;i<n;i++){
+        if(check_seen[i] > 1)
+            check_fail("PID em duas filas de prontos", i);
+        if(pt.pid[i] == 0)
+            count[READY]--;
+        else if((pt.state[i] == READY) != (check_seen[i] == 1))
+            check_fail(pt.state[i] == READY ? "app pronto fora das filas de prontos" : "app não pronto na fila de prontos", i);
+    }
+    if(ready != count[READY])
+        check_fail("tamanho das filas de prontos diverge dos apps prontos", -1);
+
+    // com -D o pedido em serviço não fica em fila: o bloqueado está na fila de espera ou em serviço
+    memset(check_seen, 0, n * sizeof(int));
+    for(int d=0;d<num_devices;d++){
+        q_each(&devs[d].q, check_visit_pid);
+        if(io_model)
+            for(int k=0;k<devs[d].pending.size;k++)
+                check_visit(devs[d].pending.it[k].idx);
+    }
+    for(int i=0;i<n;i++){
+        if(check_seen[i] > 1)
+            check_fail("PID em duas filas de dispositivo", i);
+        if(check_seen[i] == 1 && pt.state[i] != BLOCKED)
+            check_fail("app não bloqueado na fila de um dispositivo", i);
+        if(!io_model && pt.state[i] == BLOCKED && check_seen[i] == 0)
+            check_fail("app bloqueado fora das filas de dispositivo", i);
+    }
+}
+
+// Fim da simulação: todo app (e todo slot do sistema aberto) terminou
+void check_final(){
+    for(int i=0;i<num_procs_app;i++)
+        if(pt.state[i] != TERMINATED)
+            check_fail("app não chegou a TERMINATED", i);
+    printf("[Check] %ld lotes verificados, invariantes ok\n", check_batches);
+}
+
+// --------------- Checkpoint (-k/-K e -R) ---------------
+// No motor de eventos discretos o estado todo é memória do kernel: tabela de processos, apps virtuais,
+// fila de eventos, estruturas de prontos das CPUs, dispositivos, métricas e RNGs. O checkpoint é a
+// imagem binária dessas estruturas, tomada entre dois lotes; cada ponteiro vira o conteúdo do buffer
+// para onde aponta e é realocado na volta. A mesma função percorre o estado para gravar e para ler,
+// então a ordem nunca diverge. Restaurar e seguir dá exatamente o mesmo resultado da execução original.
+#define SNAP_MAGIC "SIMSNAP\0"
+#define SNAP_VERSION 1
+
+typedef struct {
+    char magic[8]; // SNAP_MAGIC
+    int version; // SNAP_VERSION
+    int layout[6]; // tamanhos das estruturas gravadas: recusa imagens de outro build
+    int num_procs, num_cpus, num_devices, io_model;
+    char policy[16];
+} SnapHeader;
+
+char *checkpoint_path = NULL; // -k
+long long checkpoint_ns = -1; // -K (tempo virtual)
+char *restore_path = NULL; // -R
+FILE *snap_file;
+int snap_loading; // lendo (-R) ou gravando (-k)
+
+static void snap_layout(int *l){
+    l[0] = sizeof(SchedState);
+    l[1] = sizeof(ProcStats);
+    l[2] = sizeof(DesApp);
+    l[3] = sizeof(Event);
+    l[4] = sizeof(Cpu);
+    l[5] = sizeof(IODevice);
+}
+
+static void snap_io(void *p, size_t n){
+    size_t done = snap_loading ? fread(p, 1, n, snap_file) : fwrite(p, 1, n, snap_file);
+    if(done != n){
+        printf("Checkpoint %s\n", snap_loading ? "truncado" : "não pôde ser gravado");
+        exit(1);
+    }
+}
+#define SNAP(v) snap_io(&(v), sizeof(v))
+
+// Buffer apontado por *pp com n bytes; na leitura o ponteiro gravado (lixo) dá lugar a um novo buffer
+static void snap_buf(void **pp, size_t n){
+    if(snap_loading){
+        *pp = malloc(n > 0 ? n : 1);
+        if(*pp == NULL){
+            printf("Erro na alocação do checkpoint\n");
+            exit(1);
+        }
+    }
+    snap_io(*pp, n);
+}
+
+// Filas e heaps gravados inteiros (cap); os de outra política nunca foram criados (cap = 0)
+static void snap_queue(PIDQueue *q){
+    if(q->cap > 0)
+        snap_buf((void **)&q->data, q->cap * sizeof(pid_t));
+}
+static void snap_key_heap(KeyHeap *h){
+    if(h->cap > 0)
+        snap_buf((void **)&h->it, h->cap * sizeof(KeyItem));
+}
+
+static void snap_image(){
+    int n = num_procs_app;
+
+    // modelo e relógios
+    SNAP(sim_seed); SNAP(max_iterations); SNAP(timeslice_ms); SNAP(prob_syscall); SNAP(p1_prob); SNAP(p2_prob);
+    SNAP(affinity_pct); SNAP(nice_list); SNAP(nice_count); SNAP(adapt_target_ns); SNAP(lot_size);
+    SNAP(des_now); SNAP(des_events); SNAP(des_ticks); SNAP(sched_ticks);
+    SNAP(ctx_switches); SNAP(adapt_decisions); SNAP(io_t0);
+    SNAP(kernel_rng); SNAP(sched_rng); SNAP(io_rng); SNAP(arrival_rng);
+
+    // tabela de processos e apps virtuais
+    snap_io(pt.pid, n * sizeof(pid_t));
+    snap_io(pt.state, n * sizeof(ProcessState));
+    snap_io(pt.pc, n * sizeof(int));
+    snap_io(pt.cpu, n * sizeof(int));
+    snap_io(pt.sched, n * sizeof(SchedState));
+    snap_io(pt.stats, n * sizeof(ProcStats));
+    for(int st=0;st<NUM_STATES;st++)
+        snap_io(pt.state_bits[st], pt.words * sizeof(uint64_t));
+    snap_io(pt.alive, pt.words * sizeof(uint64_t));
+    SNAP(pt.count);
+    snap_io(des_app, n * sizeof(DesApp));
+
+    // fila de eventos
+    SNAP(des_heap);
+    if(des_heap.cap > 0)
+        snap_buf((void **)&des_heap.ev, des_heap.cap * sizeof(Event));
+
+    // CPUs com a estrutura de prontos da política
+    for(int c=0;c<num_cpus;c++){
+        Cpu *cp = &cpus[c];
+        SNAP(*cp);
+        snap_queue(&cp->rq);
+        for(int l=0;l<MLFQ_LEVELS;l++)
+            snap_queue(&cp->mlfq_q[l]);
+        if(cp->lot_tree){
+            snap_buf((void **)&cp->lot_tree, (lot_size + 1) * sizeof(long long));
+            snap_buf((void **)&cp->lot_bits, pt.words * sizeof(uint64_t));
+        }
+        snap_key_heap(&cp->heap);
+        for(int a=0;a<2;a++)
+            for(int l=0;l<PRIO_LEVELS;l++)
+                snap_queue(&cp->prio_q[a][l]);
+    }
+
+    // dispositivos
+    for(int d=0;d<num_devices;d++){
+        SNAP(devs[d]);
+        snap_queue(&devs[d].q);
+        snap_key_heap(&devs[d].pending);
+    }
+    if(io_model)
+        snap_buf((void **)&io_req, n * sizeof(IoReq));
+
+    // sistema aberto
+    SNAP(arrival_rate); SNAP(open_window_s);
+    if(arrival_rate > 0){
+        SNAP(open_t0); SNAP(open_end); SNAP(next_arrival);
+        SNAP(open_arrivals); SNAP(open_completed); SNAP(admit_max); SNAP(open_serial);
+        SNAP(admit_q);
+        snap_key_heap(&admit_q);
+        snap_buf((void **)&pool_parked, n);
+    }
+
+    SNAP(metrics);
+}
+
+void snapshot_save(){
+    snap_file = fopen(checkpoint_path, "wb");
+    if(snap_file == NULL){
+        printf("Erro ao criar o checkpoint %s\n", checkpoint_path);
+        exit(1);
+    }
+    SnapHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAP_MAGIC, sizeof(h.magic));
+    h.version = SNAP_VERSION;
+    snap_layout(h.layout);
+    h.num_procs = num_procs_app;
+    h.num_cpus = num_cpus;
+    h.num_devices = num_devices;
+    h.io_model = io_model;
+    snprintf(h.policy, sizeof(h.policy), "%s", sched->name);
+    snap_loading = false;
+    SNAP(h);
+    snap_image();
+    long size = ftell(snap_file);
+    fclose(snap_file);
+    printf("[Checkpoint] tempo virtual %.3f s gravado em %s (%.1f MB)\n", des_now / 1e9, checkpoint_path, size / 1048576.0);
+}
+
+// Lê o cabeçalho antes da alocação da tabela: ele define apps, CPUs, dispositivos e política
+void snapshot_open(){
+    snap_file = fopen(restore_path, "rb");
+    SnapHeader h;
+    int layout[6];
+    snap_layout(layout);
+    if(snap_file == NULL || fread(&h, sizeof(h), 1, snap_file) != 1 || memcmp(h.magic, SNAP_MAGIC, sizeof(h.magic)) != 0){
+        printf("Arquivo não é um checkpoint do simulador: %s\n", restore_path);
+        exit(1);
+    }
+    if(h.version != SNAP_VERSION || memcmp(h.layout, layout, sizeof(layout)) != 0){
+        printf("Checkpoint de outra versão do simulador (versão %d)\n", h.version);
+        exit(1);
+    }
+    num_procs_app = h.num_procs;
+    num_cpus = h.num_cpus;
+    num_devices = h.num_devices;
+    io_model = h.io_model;
+    sched = NULL;
+    for(unsigned k=0;k<sizeof(policies)/sizeof(policies[0]);k++)
+        if(strcmp(h.policy, policies[k].name) == 0)
+            sched = &policies[k];
+    if(sched == NULL){
+        printf("Política do checkpoint desconhecida: %s\n", h.policy);
+        exit(1);
+    }
+}
+
+// Lê o resto da imagem e refaz o que é derivado dela (mapa de PIDs e fibras dos apps)
+void snapshot_load(){
+    snap_loading = true;
+    snap_image();
+    fclose(snap_file);
+    for(int i=0;i<num_procs_app;i++)
+        if(pt.pid[i] > 0)
+            pidmap_put(&pid_map, pt.pid[i], i);
+    if(app_fibers){ // cada app vivo está parado no pedido de CPU da iteração atual
+        fibers_init();
+        for(int i=0;i<num_procs_app;i++)
+            if(pt.pid[i] > 0 && pt.state[i] != TERMINATED)
+                fiber_make(i, true);
+    }
+    printf("[Checkpoint] restaurado de %s em tempo virtual %.3f s (%d apps, política %s)\n",
+           restore_path, des_now / 1e9, num_procs_app, sched->name);
+}
+
+// Estado inicial: CPUs, dispositivos, apps registrados e primeiros eventos
+void des_setup(){
+    cpus_init();
+    devices_init();
+
+    if(arrival_rate > 0)
+        open_init();
+
+    if(app_fibers)
+        fibers_init();
+
+    for(int i=0;i<num_procs_app;i++){
+        pcb_init(i);
+        des_app[i].remaining = APP_STEP_MS * 1000000LL;
+        rng_seed(&des_app[i].rng, sim_seed ^ ((unsigned long long)(i + 1) << 32));
+        if(arrival_rate > 0)
+            pool_add(i, DES_VPID_BASE + i);
+        else if(!workload_path){
+            pcb_register(i, DES_VPID_BASE + i);
+            if(app_fibers)
+                fiber_start(i);
+        }
+        else if(wl.arrival_ns[i] == 0){ // a primeira ação é lida quando o app recebe a CPU
+            des_app[i].remaining = 0;
+            pcb_register(i, DES_VPID_BASE + i);
+            wl_arrived++;
+        } else {
+            des_app[i].remaining = 0;
+            heap_push(&des_heap, wl.arrival_ns[i], EV_ARRIVAL, i, 0);
+        }
+    }
+
+    start_first();
+    heap_push(&des_heap, timeslice_ms * 1000000LL, EV_TICK, -1, 0);
+    if(arrival_rate > 0 && next_arrival < open_end)
+        heap_push(&des_heap, next_arrival, EV_OPEN_ARRIVAL, -1, 0);
+    if(workload_path && !io_model) // com -D as IRQs de dispositivo vêm do modelo de serviço
+        des_wl_push_irq();
+}
+
+int des_main(){
+    des_app = calloc(num_procs_app, sizeof(DesApp));
+    if(des_app == NULL){
+        printf("Erro na alocação dos apps virtuais\n");
+        exit(1);
+    }
+    rng_seed(&kernel_rng, sim_seed);
+    if(trace_path)
+        trace_open();
+
+    if(restore_path)
+        snapshot_load(); // continua de onde o checkpoint parou
+    else
+        des_setup();
+    if(stats_path)
+        stats_open();
+
+    long long wall_start = mono_ns();
+    while(des_heap.size > 0){
+        if(kernel_finished())
+            break;
+        if(workload_path && !io_model && des_wl_stuck()){
+            printf("[DES] O workload não tem mais IRQs para desbloquear %d apps; encerrando\n", devices_blocked());
+            break;
+        }
+
+        if(got_sigint){
+            got_sigint = 0;
+            print_status_table();
+            pause();
+        }
+
+        // checkpoint entre dois lotes, antes do primeiro evento no instante pedido ou depois dele
+        if(checkpoint_path && des_heap.ev[0].t >= checkpoint_ns){
+            snapshot_save();
+            checkpoint_path = NULL;
+        }
+
+        Event e = heap_pop(&des_heap);
+        des_now = e.t;
+        des_events++;
+        if(e.type == EV_TICK)
+            des_tick();
+        else if(e.type == EV_ARRIVAL){
+            pcb_register(e.idx, DES_VPID_BASE + e.idx);
+            wl_arrived++;
+        } else if(e.type == EV_OPEN_ARRIVAL){ // admitida no kernel_dispatch deste lote
+            open_arrive(des_now);
+            next_arrival += arrival_gap();
+            if(next_arrival < open_end)
+                heap_push(&des_heap, next_arrival, EV_OPEN_ARRIVAL, -1, 0);
+        } else if(e.type == EV_IO_DONE){
+            io_complete(e.idx);
+        } else if(e.type == EV_IRQ){
+            IRQMsg m;
+            m.type = e.idx == DEVICE_D1 ? IRQ_IO_D1 : IRQ_IO_D2;
+            m.cpu = 0;
+            handle_irq_msg(&m);
+            des_wl_push_irq();
+        } else if(e.gen == des_app[e.idx].gen){ // evento de app ainda válido
+            if(workload_path)
+                des_wl_step(e.idx);
+            else if(app_fibers)
+                fiber_run(e.idx);
+            else
+                des_app_step(e.idx);
+        }
+        kernel_dispatch(); // cada evento é um lote
+    }
+
+    if(check_on && !(workload_path && devices_blocked() > 0)) // workload sem IRQs para todos já foi avisado
+        check_final();
+    if(checkpoint_path)
+        printf("[Checkpoint] a simulação acabou antes de %.3f s; nada foi gravado\n", checkpoint_ns / 1e9);
+    double wall = (mono_ns() - wall_start) / 1e9;
+    printf("[DES] política %s | tempo virtual %.3f s | %ld timeslices | %ld trocas | %ld eventos | %.3f s reais | %.0f timeslices/s | %.0f eventos/s\n",
+           sched->name, des_now / 1e9, des_ticks, ctx_switches, des_events, wall,
+           wall > 0 ? des_ticks / wall : 0.0, wall > 0 ? des_events / wall : 0.0);
+    trace_close();
+    stats_close();
+    print_open_stats();
+    print_adapt();
+    print_fibers();
+    print_cpu_stats();
+    print_devices();
+    print_metrics();
+    return 0;
+}
+
+// --------------- Benchmarks (--bench) ---------------
+// Mede os caminhos quentes do escalonador e imprime o resultado em JSON (make bench)
+#define BENCH_QUEUE_OPS 20000000
+#define BENCH_LOOKUPS 10000000
+#define BENCH_ROUNDTRIPS 20000
+#define BENCH_SWITCHES 20000
+
+// q_push + q_pop com a fila em regime (tamanho constante)
+void bench_queue(){
+    PIDQueue q;
+    q_init(&q);
+    for(int i=0;i<1024;i++)
+        q_push(&q, i);
+    long long sum = 0;
+    long long t0 = mono_ns();
+    for(int i=0;i<BENCH_QUEUE_OPS;i++){
+        q_push(&q, i);
+        sum += q_pop(&q);
+    }
+    long long dt = mono_ns() - t0;
+    printf("  \"queue\": {\"ops\": %d, \"ns_per_push_pop\": %.2f, \"mops_per_s\": %.1f, \"checksum\": %lld},\n",
+           BENCH_QUEUE_OPS, (double)dt / BENCH_QUEUE_OPS, BENCH_QUEUE_OPS / (dt / 1e3), sum % 1000);
+    free(q.data);
+}
+
+// app_index_from_pid com N processos, em ordem pseudoaleatória
+void bench_lookup(){
+    int sizes[] = { 16, 256, 4096, 65536, 1048576 };
+    int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+    Rng r;
+    rng_seed(&r, 42);
+    printf("  \"pid_lookup\": [");
+    for(int k=0;k<nsizes;k++){
+        int n = sizes[k];
+        pid_t *pids = malloc(n * sizeof(pid_t));
+        pidmap_init(&pid_map, n);
+        for(int i=0;i<n;i++){
+            pids[i] = 300 + i * 7; // PIDs esparsos, como os do sistema
+            pidmap_put(&pid_map, pids[i], i);
+        }
+        long long sum = 0;
+        long long t0 = mono_ns();
+        for(int i=0;i<BENCH_LOOKUPS;i++)
+            sum += app_index_from_pid(pids[rng_range(&r, n)]);
+        long long dt = mono_ns() - t0;
+        printf("%s{\"n\": %d, \"ns_per_lookup\": %.2f, \"checksum\": %lld}", k ? ", " : "", n, (double)dt / BENCH_LOOKUPS, sum % 1000);
+        free(pids);
+        free(pid_map.keys);
+        free(pid_map.vals);
+    }
+    printf("],\n");
+}
+
+// Ida e volta de um AppMsg por pipes entre o kernel e um filho que devolve a mensagem
+void bench_pipe(){
+    int to_child[2], to_parent[2];
+    if(pipe(to_child) < 0 || pipe(to_parent) < 0)
+        return;
+    pid_t c = fork();
+    if(c == 0){
+        AppMsg m;
+        close(to_child[1]);
+        close(to_parent[0]);
+        while(read(to_child[0], &m, sizeof(m)) == sizeof(m))
+            write(to_parent[1], &m, sizeof(m));
+        exit(0);
+    }
+    close(to_child[0]);
+    close(to_parent[1]);
+    Hist *h = calloc(1, sizeof(Hist));
+    AppMsg m = { APP_PROGRESS, getpid(), -1, 0 };
+    long long t0 = mono_ns();
+    for(int i=0;i<BENCH_ROUNDTRIPS;i++){
+        long long t = mono_ns();
+        m.op = i;
+        write(to_child[1], &m, sizeof(m));
+        read(to_parent[0], &m, sizeof(m));
+        hist_record(h, mono_ns() - t);
+    }
+    long long dt = mono_ns() - t0;
+    close(to_child[1]);
+    close(to_parent[0]);
+    waitpid(c, NULL, 0);
+    printf("  \"pipe_roundtrip\": {\"iterations\": %d, \"ns_per_roundtrip\": %.0f, \"p50_ns\": %lld, \"p99_ns\": %lld},\n",
+           BENCH_ROUNDTRIPS, (double)dt / BENCH_ROUNDTRIPS, hist_percentile(h, 0.50), hist_percentile(h, 0.99));
+    free(h);
+}
+
+// schedule_next/switch_to reais alternando entre dois filhos que giram na CPU, com o mecanismo de
+// suspensão mode. "handoff" vai do início de schedule_next até o filho escolhido voltar a girar: antes de
+// retomá-lo o kernel publica uma ficha nova e o filho, ao vê-la, anota o instante num slot compartilhado.
+// stop_cont é só o trecho parar + retomar do kernel.
+void bench_switch(SuspendMode mode, char *label, int last){
+    num_procs_app = 2;
+    proc_table_init(num_procs_app);
+    pidmap_init(&pid_map, num_procs_app);
+    sched = &policies[0];
+    num_cpus = 1;
+    cpus_init();
+    verbose = false;
+    suspend_mode = mode;
+    if(mode == SUSPEND_FUTEX && permit_open(num_procs_app) < 0){
+        printf("Erro na criação das permissões de execução\n");
+        exit(1);
+    }
+    _Atomic long long *resumed = mmap(NULL, 4096, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(resumed == MAP_FAILED){
+        printf("Erro no mmap do benchmark\n");
+        exit(1);
+    }
+    for(int i=0;i<num_procs_app;i++){
+        pcb_init(i);
+        pid_t c = fork();
+        if(c == 0){
+            if(mode == SUSPEND_FUTEX)
+                permit_wait(i);
+            else
+                kill(getpid(), SIGSTOP);
+            long long seen = 0;
+            while(1){ // consome CPU até ser parado
+                if(mode == SUSPEND_FUTEX)
+                    permit_wait(i);
+                long long token = atomic_load(&resumed[i * 8 + 1]);
+                if(token != seen){ // primeira volta depois de retomado
+                    seen = token;
+                    atomic_store(&resumed[i * 8], mono_ns()); // um par de slots por linha de cache
+                }
+                sched_yield(); // com um só núcleo o kernel precisa voltar a executar
+            }
+        }
+        if(mode == SUSPEND_SIGNAL)
+            waitpid(c, NULL, WUNTRACED); // espera o filho se parar
+        pcb_register(i, c);
+    }
+    start_first();
+    memset(&metrics[MET_SWITCH], 0, sizeof(Hist));
+    Hist *handoff = calloc(1, sizeof(Hist));
+    long long t0 = mono_ns();
+    for(int i=0;i<BENCH_SWITCHES;i++){
+        int next = 1 - current_index(0);
+        atomic_store(&resumed[next * 8], 0);
+        long long t = mono_ns();
+        atomic_store(&resumed[next * 8 + 1], t);
+        schedule_next(0);
+        long long r;
+        while((r = atomic_load(&resumed[next * 8])) == 0)
+            sched_yield(); // com um só núcleo o filho precisa desta CPU
+        hist_record(handoff, r > t ? r - t : 0);
+    }
+    long long dt = mono_ns() - t0;
+    for(int i=0;i<num_procs_app;i++){
+        kill(pt.pid[i], SIGKILL);
+        waitpid(pt.pid[i], NULL, 0);
+    }
+    Hist *h = &metrics[MET_SWITCH];
+    printf("  \"%s\": {\"iterations\": %d, \"ns_per_schedule\": %.0f, \"stop_cont_p50_ns\": %lld, \"stop_cont_p99_ns\": %lld, \"stop_cont_max_ns\": %lld, "
+           "\"handoff_p50_ns\": %lld, \"handoff_p99_ns\": %lld}%s\n",
+           label, BENCH_SWITCHES, (double)dt / BENCH_SWITCHES, hist_percentile(h, 0.50), hist_percentile(h, 0.99), h->max,
+           hist_percentile(handoff, 0.50), hist_percentile(handoff, 0.99), last ? "" : ",");
+    free(handoff);
+    munmap((void *)resumed, 4096);
+}
+
+int bench_main(){
+    printf("{\n");
+    printf("  \"cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+    fflush(stdout);
+    bench_queue();
+    bench_lookup();
+    fflush(stdout); // antes dos forks, para o buffer não ser duplicado nos filhos
+    bench_pipe();
+    fflush(stdout);
+#ifdef __linux__
+    bench_switch(SUSPEND_SIGNAL, "switch_signal", false);
+    fflush(stdout);
+    bench_switch(SUSPEND_FUTEX, "switch_futex", true);
+#else
+    bench_switch(SUSPEND_SIGNAL, "switch_signal", true);
+#endif
+    printf("}\n");
+    return 0;
+}
+
+int run_bench = false; // --bench
+
+// --------------- Varredura de parâmetros (-W) ---------------
+// Cada -W NOME=VALORES varre um parâmetro; a varredura executa o produto cartesiano, uma simulação de
+// eventos discretos por configuração, em processos filhos (até -j de cada vez, padrão = núcleos do
+// host). As demais opções da linha de comando (-D, -r, -a, ...) valem para todas as configurações.
+// Cada filho grava o resultado no seu slot de uma área compartilhada; no fim sai um CSV, uma linha por
+// configuração, na ordem da varredura.
+#define SWEEP_MAX_VALUES 1024 // valores por parâmetro
+
+typedef enum {
+    SW_POLICY = 0,
+    SW_TIMESLICE,
+    SW_SYSCALL,
+    SW_P1,
+    SW_P2,
+    SW_ITER,
+    SW_PROCS,
+    SW_CPUS,
+    SW_SEED,
+    SW_NUM
+} SweepKey;
+
+char *sweep_keys[SW_NUM] = { "policy", "timeslice", "syscall", "p1", "p2", "iter", "n", "cpus", "seed" };
+long long sweep_vals[SW_NUM][SWEEP_MAX_VALUES];
+int sweep_n[SW_NUM]; // 0 = parâmetro não varrido (vale o da linha de comando)
+int sweep_on = false;
+int sweep_jobs = 0; // -j; 0 = núcleos do host
+
+typedef struct {
+    int ok;
+    double virtual_s, wall_s;
+    long completed, switches;
+    long long wait_p50, wait_p99, resp_p50, resp_p99, turn_mean, turn_p50, turn_p99;
+} SweepResult;
+
+void sweep_add_value(int k, long long v, char *spec){
+    if(sweep_n[k] == SWEEP_MAX_VALUES){
+        printf("Valores demais em %s (máximo %d)\n", spec, SWEEP_MAX_VALUES);
+        exit(1);
+    }
+    sweep_vals[k][sweep_n[k]++] = v;
+}
+
+// NOME=V1,V2,... ou NOME=INÍCIO:FIM[:PASSO]; policy aceita só a lista de nomes
+void parse_sweep(char *spec){
+    char *eq = strchr(spec, '=');
+    int k = 0;
+    while(k < SW_NUM && (eq == NULL || strlen(sweep_keys[k]) != (size_t)(eq - spec) || strncmp(spec, sweep_keys[k], eq - spec) != 0))
+        k++;
+    if(k == SW_NUM){
+        printf("Varredura inválida: %s (parâmetros: policy, timeslice, syscall, p1, p2, iter, n, cpus, seed)\n", spec);
+        exit(1);
+    }
+    sweep_n[k] = 0;
+    sweep_on = true;
+    for(char *p=eq+1; *p; ){
+        char *end = strchr(p, ',');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if(k == SW_POLICY){
+            unsigned j = 0;
+            while(j < sizeof(policies)/sizeof(policies[0]) && (strlen(policies[j].name) != len || strncmp(p, policies[j].name, len) != 0))
+                j++;
+            if(j == sizeof(policies)/sizeof(policies[0])){
+                printf("Política inválida na varredura: %.*s\n", (int)len, p);
+                exit(1);
+            }
+            sweep_add_value(k, j, spec);
+        } else {
+            char *q;
+            long long a = strtoll(p, &q, 10), b = a, step = 1;
+            if(*q == ':'){
+                b = strtoll(q + 1, &q, 10);
+                if(*q == ':')
+                    step = strtoll(q + 1, &q, 10);
+            }
+            if(q == p || q != p + len || step <= 0 || b < a){
+                printf("Valores inválidos na varredura: %s\n", spec);
+                exit(1);
+            }
+            for(long long v=a;v<=b;v+=step)
+                sweep_add_value(k, v, spec);
+        }
+        p += len;
+        if(*p == ',')
+            p++;
+    }
+}
+
+// Valor atual de cada parâmetro (o da linha de comando quando não é varrido)
+long long sweep_current(int k){
+    switch(k){
+        case SW_POLICY: return sched - policies;
+        case SW_TIMESLICE: return timeslice_ms;
+        case SW_SYSCALL: return prob_syscall;
+        case SW_P1: return p1_prob;
+        case SW_P2: return p2_prob;
+        case SW_ITER: return max_iterations;
+        case SW_PROCS: return num_procs_app;
+        case SW_CPUS: return num_cpus;
+    }
+    return (long long)sim_seed;
+}
+
+// Configuração n: o índice é decomposto como um número misto, um dígito por parâmetro varrido
+void sweep_config(long n, long long *v){
+    for(int k=0;k<SW_NUM;k++){
+        v[k] = sweep_current(k);
+        if(sweep_n[k] > 0){
+            v[k] = sweep_vals[k][n % sweep_n[k]];
+            n /= sweep_n[k];
+        }
+    }
+}
+
+// No filho: aplica a configuração, simula em silêncio e devolve as métricas no slot compartilhado
+void sweep_run(long n, SweepResult *res){
+    long long v[SW_NUM];
+    sweep_config(n, v);
+    sched = &policies[v[SW_POLICY]];
+    timeslice_ms = v[SW_TIMESLICE];
+    prob_syscall = v[SW_SYSCALL];
+    p1_prob = v[SW_P1];
+    p2_prob = v[SW_P2];
+    max_iterations = v[SW_ITER];
+    num_procs_app = v[SW_PROCS];
+    num_cpus = v[SW_CPUS];
+    sim_seed = v[SW_SEED];
+    if(timeslice_ms <= 0 || max_iterations <= 0 || num_procs_app <= 0 || num_cpus <= 0 || num_cpus > MAX_CPUS ||
+       prob_syscall < 0 || prob_syscall > 100 || p1_prob < 0 || p1_prob > 100 || p2_prob < 0 || p2_prob > 100)
+        exit(1); // res->ok continua false
+
+    verbose = false;
+    if(freopen("/dev/null", "w", stdout) == NULL)
+        exit(1);
+    proc_table_init(num_procs_app);
+    pidmap_init(&pid_map, num_procs_app);
+    rng_seed(&sched_rng, sim_seed + 1);
+    long long w0 = mono_ns();
+    des_main();
+
+    res->wall_s = (mono_ns() - w0) / 1e9;
+    res->virtual_s = des_now / 1e9;
+    res->completed = arrival_rate > 0 ? open_completed : pt.count[TERMINATED];
+    res->switches = ctx_switches;
+    res->wait_p50 = hist_percentile(&metrics[MET_WAIT], 0.50);
+    res->wait_p99 = hist_percentile(&metrics[MET_WAIT], 0.99);
+    res->resp_p50 = hist_percentile(&metrics[MET_RESPONSE], 0.50);
+    res->resp_p99 = hist_percentile(&metrics[MET_RESPONSE], 0.99);
+    Hist *t = &metrics[MET_TURNAROUND];
+    res->turn_mean = t->n ? t->sum / t->n : 0;
+    res->turn_p50 = hist_percentile(t, 0.50);
+    res->turn_p99 = hist_percentile(t, 0.99);
+    res->ok = true;
+    exit(0);
+}
+
+int sweep_main(){
+    if(trace_path || stats_path){
+        printf("A varredura (-W) não combina com --trace nem --stats\n");
+        exit(1);
+    }
+    if(workload_path && sweep_n[SW_PROCS] > 0){
+        printf("Com -w a quantidade de apps vem do workload; não varra n\n");
+        exit(1);
+    }
+    long total = 1;
+    for(int k=0;k<SW_NUM;k++)
+        if(sweep_n[k] > 0)
+            total *= sweep_n[k];
+    int jobs = sweep_jobs;
+    if(jobs <= 0){
+        long hc = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = hc > 0 ? hc : 1;
+    }
+    SweepResult *res = mmap(NULL, total * sizeof(SweepResult), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(res == MAP_FAILED){
+        printf("Erro na alocação dos resultados da varredura\n");
+        exit(1);
+    }
+    memset(res, 0, total * sizeof(SweepResult));
+
+    long long w0 = mono_ns();
+    fflush(stdout); // antes dos forks, para o buffer não ser duplicado nos filhos
+    long next = 0, running = 0;
+    while(next < total || running > 0){
+        if(next < total && running < jobs){
+            pid_t p = fork();
+            if(p < 0){
+                printf("Erro na criação dos processos da varredura\n");
+                exit(1);
+            }
+            if(p == 0)
+                sweep_run(next, &res[next]);
+            next++;
+            running++;
+        } else if(wait(NULL) > 0)
+            running--;
+    }
+
+    printf("policy,timeslice_ms,syscall_pct,p1_pct,p2_pct,iterations,procs,cpus,seed,ok,virtual_s,completed,"
+           "throughput_per_s,switches,wait_p50_ns,wait_p99_ns,response_p50_ns,response_p99_ns,"
+           "turnaround_mean_ns,turnaround_p50_ns,turnaround_p99_ns,wall_s\n");
+    long failed = 0;
+    for(long n=0;n<total;n++){
+        long long v[SW_NUM];
+        sweep_config(n, v);
+        SweepResult *r = &res[n];
+        failed += !r->ok;
+        printf("%s,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%d,%.3f,%ld,%.6f,%ld,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%.4f\n",
+               policies[v[SW_POLICY]].name, v[SW_TIMESLICE], v[SW_SYSCALL], v[SW_P1], v[SW_P2], v[SW_ITER],
+               v[SW_PROCS], v[SW_CPUS], v[SW_SEED], r->ok, r->virtual_s, r->completed,
+               r->virtual_s > 0 ? r->completed / r->virtual_s : 0.0, r->switches, r->wait_p50, r->wait_p99,
+               r->resp_p50, r->resp_p99, r->turn_mean, r->turn_p50, r->turn_p99, r->wall_s);
+    }
+    fprintf(stderr, "[Varredura] %ld configurações em %.2f s com %d processos (%ld falharam)\n",
+            total, (mono_ns() - w0) / 1e9, jobs, failed);
+    munmap(res, total * sizeof(SweepResult));
+    return failed > 0;
+}
+
+// Uso da linha de comando
+void usage(char *prog){
+    printf("Uso: %s [-n NUM_APPS] [-c CPUS] [-a PCT] [-r TAXA [-d SEG]] [-w WORKLOAD] [-D DISPOSITIVO]... [-e real|des|fiber] [-l select|epoll] [-t ic|timerfd] [-T pipe|shm] [-S signal|futex] [-P msg|shm] [-p POLÍTICA] [-N NICES] [-s SEMENTE] [-o TRACE] [-L NÍVEL] [-m STATS] [-A META_MS] [-k ARQ -K SEG] [-R ARQ] [-W NOME=VALORES]... [-j N] [-C] [-q] [-B]\n", prog);
+    printf("  -n, --procs N   quantidade de application processes (padrão %d)\n", NUM_PROCS_APP);
+    printf("  -c, --cpus N    CPUs simuladas, cada uma com sua fila de prontos e roubo de trabalho (padrão 1)\n");
+    printf("  -a, --affinity P  porcentagem de apps fixados na CPU de origem (padrão 0)\n");
+    printf("  -r, --rate R    sistema aberto: apps chegam à taxa R por segundo (Poisson) e saem ao terminar;\n");
+    printf("                  -n vira o máximo de apps simultâneos (chegadas sem slot esperam na fila de admissão)\n");
+    printf("  -d, --duration S  duração das chegadas do sistema aberto em segundos (padrão %d)\n", OPEN_WINDOW_S);
+    printf("  -w, --workload F  replay do trace de workload F (formato no README; exige -e des; ignora -n)\n");
+    printf("  -D, --device SPEC dispositivo com modelo de serviço, repetível (ex.: depth=2,order=sjf,read=exp:5,write=const:20)\n");
+    printf("                  order: fifo, sjf ou deadline; tempos em ms: const:M, exp:MÉDIA ou uniform:MIN:MAX\n");
+    printf("  -l, --loop L    backend do loop do kernel: select (padrão) ou epoll (Linux)\n");
+    printf("  -t, --timer T   origem das IRQs: ic (processo InterController, padrão) ou timerfd (Linux)\n");
+    printf("  -T, --transport M  mensagens dos apps: pipe (padrão) ou shm (anel em memória compartilhada, Linux)\n");
+    printf("  -S, --suspend M parada dos apps: signal (SIGSTOP/SIGCONT, padrão) ou futex (permissão de execução, Linux)\n");
+    printf("  -P, --progress M  PC dos apps: msg (APP_PROGRESS a cada iteração, padrão) ou shm (contador em memória\n");
+    printf("                  compartilhada lido pelo kernel só quando precisa; no transporte ficam syscalls e términos)\n");
+    printf("  -s, --seed S    semente das IRQs de dispositivo (padrão time(NULL))\n");
+    printf("  -e, --engine E  real (processos e sinais, padrão), des (eventos discretos em tempo virtual) ou fiber\n");
+    printf("                  (eventos discretos com o código dos apps em fibras ucontext dentro do kernel)\n");
+    printf("  -p, --policy P  escalonador: rr (padrão), mlfq, lottery, stride, cfs ou o1 (filas por prioridade)\n");
+    printf("  -N, --nice L    nices dos apps para o o1, em ciclo (ex.: 0,-5,10); padrão 0\n");
+    printf("  -o, --trace F   grava os eventos do kernel em F no formato binário (ver simtrace)\n");
+    printf("  -L, --trace-level N  1 = chegada e término, 2 = + escalonamento e E/S (padrão), 3 = + progresso e ticks\n");
+    printf("  -m, --stats F   publica a tabela de status em F a cada %d ms, sem parar o kernel (ver simstat)\n", STATS_PERIOD_MS);
+    printf("  -A, --adaptive M  quantum por app ajustado pelos bloqueios, surtos de CPU e prontos, com meta de resposta de M ms;\n");
+    printf("                  o IRQ0 vira um tick de %d ms e o quantum fica entre %d e %d ms\n", ADAPT_TICK_MS, ADAPT_QMIN_MS, ADAPT_QMAX_MS);
+    printf("  -k, --checkpoint F  grava em F o estado completo da simulação de eventos discretos ao atingir -K\n");
+    printf("  -K, --checkpoint-at S  instante virtual do checkpoint, em segundos\n");
+    printf("  -R, --restore F continua a simulação do checkpoint F (apps, CPUs, política e modelo vêm dele)\n");
+    printf("  -W, --sweep P=V varre o parâmetro P (policy, timeslice, syscall, p1, p2, iter, n, cpus, seed), repetível;\n");
+    printf("                  V é uma lista (a,b,c) ou faixa (INÍCIO:FIM[:PASSO]); imprime um CSV por configuração (DES)\n");
+    printf("  -j, --jobs N    simulações simultâneas na varredura (padrão: núcleos do host)\n");
+    printf("  -C, --check     confere as invariantes da tabela e das filas a cada lote (lento; no modo real também pega corridas entre apps e kernel)\n");
+    printf("  -q, --quiet     não imprime os eventos do kernel\n");
+    printf("  -B, --bench     executa os micro-benchmarks e imprime JSON\n");
+}
+
+// Lê as opções da linha de comando
+void parse_args(int argc, char *argv[]){
+    static struct option long_opts[] = {
+        {"procs", required_argument, 0, 'n'},
+        {"cpus",  required_argument, 0, 'c'},
+        {"affinity", required_argument, 0, 'a'},
+        {"rate", required_argument, 0, 'r'},
+        {"duration", required_argument, 0, 'd'},
+        {"workload", required_argument, 0, 'w'},
+        {"device", required_argument, 0, 'D'},
+        {"loop",  required_argument, 0, 'l'},
+        {"timer", required_argument, 0, 't'},
+        {"seed",  required_argument, 0, 's'},
+        {"transport", required_argument, 0, 'T'},
+        {"suspend", required_argument, 0, 'S'},
+        {"progress", required_argument, 0, 'P'},
+        {"engine", required_argument, 0, 'e'},
+        {"policy", required_argument, 0, 'p'},
+        {"nice", required_argument, 0, 'N'},
+        {"trace", required_argument, 0, 'o'},
+        {"trace-level", required_argument, 0, 'L'},
+        {"stats", required_argument, 0, 'm'},
+        {"adaptive", required_argument, 0, 'A'},
+        {"check", no_argument,       0, 'C'},
+        {"checkpoint", required_argument, 0, 'k'},
+        {"checkpoint-at", required_argument, 0, 'K'},
+        {"restore", required_argument, 0, 'R'},
+        {"sweep", required_argument, 0, 'W'},
+        {"jobs",  required_argument, 0, 'j'},
+        {"quiet", no_argument,       0, 'q'},
+        {"bench", no_argument,       0, 'B'},
+        {"help",  no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+    int c;
+    sim_seed = (unsigned long long)time(NULL);
+    while((c = getopt_long(argc, argv, "n:c:a:r:d:w:D:l:t:T:S:P:s:e:p:N:o:L:m:A:k:K:R:W:j:CqBh", long_opts, NULL)) != -1){
+        switch(c){
+            case 'n':
+                num_procs_app = atoi(optarg);
+                if(num_procs_app <= 0){
+                    printf("Quantidade de apps inválida: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'c':
+                num_cpus = atoi(optarg);
+                if(num_cpus <= 0 || num_cpus > MAX_CPUS){
+                    printf("Quantidade de CPUs inválida: %s (1..%d)\n", optarg, MAX_CPUS);
+                    exit(1);
+                }
+                break;
+            case 'a':
+                affinity_pct = atoi(optarg);
+                if(affinity_pct < 0 || affinity_pct > 100){
+                    printf("Porcentagem de afinidade inválida: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'r':
+                arrival_rate = atof(optarg);
+                if(arrival_rate <= 0){
+                    printf("Taxa de chegada inválida: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'd':
+                open_window_s = atof(optarg);
+                if(open_window_s <= 0){
+                    printf("Duração inválida: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'w':
+                workload_path = optarg;
+                break;
+            case 'D':
+                parse_device(optarg);
+                break;
+            case 'l':
+                if(strcmp(optarg, "select") == 0)
+                    loop_backend = LOOP_SELECT;
+#ifdef __linux__
+                else if(strcmp(optarg, "epoll") == 0)
+                    loop_backend = LOOP_EPOLL;
+#endif
+                else {
+                    printf("Backend de loop inválido: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 't':
+                if(strcmp(optarg, "ic") == 0)
+                    timer_source = TIMER_IC;
+#ifdef __linux__
+                else if(strcmp(optarg, "timerfd") == 0)
+                    timer_source = TIMER_TIMERFD;
+#endif
+                else {
+                    printf("Origem de timer inválida: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'T':
+                if(strcmp(optarg, "pipe") == 0)
+                    transport = TRANSPORT_PIPE;
+#ifdef __linux__
+                else if(strcmp(optarg, "shm") == 0)
+                    transport = TRANSPORT_SHM;
+#endif
+                else {
+                    printf("Transporte inválido: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'S':
+                if(strcmp(optarg, "signal") == 0)
+                    suspend_mode = SUSPEND_SIGNAL;
+#ifdef __linux__
+                else if(strcmp(optarg, "futex") == 0)
+                    suspend_mode = SUSPEND_FUTEX;
+#endif
+                else {
+                    printf("Suspensão inválida: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'P':
+                if(strcmp(optarg, "msg") == 0)
+                    progress_mode = PROGRESS_MSG;
+                else if(strcmp(optarg, "shm") == 0)
+                    progress_mode = PROGRESS_SHM;
+                else {
+                    printf("Modo de progresso inválido: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 's':
+                sim_seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'e':
+                if(strcmp(optarg, "real") == 0)
+                    engine = ENGINE_REAL;
+                else if(strcmp(optarg, "des") == 0)
+                    engine = ENGINE_DES;
+                else if(strcmp(optarg, "fiber") == 0){
+                    engine = ENGINE_DES;
+                    app_fibers = true;
+                } else {
+                    printf("Motor inválido: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'p':
+                sched = NULL;
+                for(unsigned k=0;k<sizeof(policies)/sizeof(policies[0]);k++)
+                    if(strcmp(optarg, policies[k].name) == 0)
+                        sched = &policies[k];
+                if(sched == NULL){
+                    printf("Política inválida: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'N':
+                nice_count = 0;
+                for(char *p=optarg; *p; ){
+                    char *end;
+                    long v = strtol(p, &end, 10);
+                    if(end == p || v < -PRIO_DEFAULT || v >= PRIO_LEVELS - PRIO_DEFAULT || nice_count == MAX_NICE ||
+                       (*end != ',' && *end != '\0')){
+                        printf("Lista de nices inválida: %s (valores de %d a %d)\n", optarg, -PRIO_DEFAULT, PRIO_LEVELS - PRIO_DEFAULT - 1);
+                        exit(1);
+                    }
+                    nice_list[nice_count++] = v;
+                    p = *end ? end + 1 : end;
+                }
+                break;
+            case 'o':
+                trace_path = optarg;
+                break;
+            case 'L':
+                trace_level = atoi(optarg);
+                if(trace_level < 1 || trace_level > 3){
+                    printf("Nível de trace inválido: %s (1..3)\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'm':
+                stats_path = optarg;
+                break;
+            case 'A':
+                adapt_target_ns = atoi(optarg) * 1000000LL;
+                if(adapt_target_ns <= 0){
+                    printf("Meta de resposta inválida: %s (ms)\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'k':
+                checkpoint_path = optarg;
+                break;
+            case 'K':
+                checkpoint_ns = (long long)(atof(optarg) * 1e9);
+                if(checkpoint_ns < 0){
+                    printf("Instante do checkpoint inválido: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'R':
+                restore_path = optarg;
+                break;
+            case 'W':
+                parse_sweep(optarg);
+                break;
+            case 'j':
+                sweep_jobs = atoi(optarg);
+                if(sweep_jobs <= 0){
+                    printf("Quantidade de processos inválida: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'C':
+                check_on = true;
+                break;
+            case 'q':
+                verbose = false;
+                break;
+            case 'B':
+                run_bench = true;
+                break;
+            case 'h':
+                usage(argv[0]);
+                exit(0);
+            default:
+                usage(argv[0]);
+                exit(1);
+        }
+    }
+}
+
+// --------------- Kernel (Main) ---------------
+int main(int argc, char *argv[]){
+    parse_args(argc, argv);
+    if(run_bench)
+        return bench_main();
+    if(sweep_on || restore_path)
+        engine = ENGINE_DES; // a varredura e o checkpoint só usam o motor de eventos discretos
+    if(checkpoint_path || restore_path){
+        if(checkpoint_path && engine != ENGINE_DES){
+            printf("O checkpoint (-k) precisa do motor de eventos discretos (-e des ou -e fiber)\n");
+            exit(1);
+        }
+        if(checkpoint_path && checkpoint_ns < 0){
+            printf("Informe o instante virtual do checkpoint com -K SEG\n");
+            exit(1);
+        }
+        if(workload_path || sweep_on){
+            printf("O checkpoint não combina com o replay de workload (-w) nem com a varredura (-W)\n");
+            exit(1);
+        }
+    }
+    if(adapt_target_ns){
+        if(sweep_n[SW_TIMESLICE]){
+            printf("Com -A o timeslice é o tick de %d ms e o quantum é decidido por app; não varie timeslice com -W\n", ADAPT_TICK_MS);
+            exit(1);
+        }
+        timeslice_ms = ADAPT_TICK_MS; // o quantum passa a ser decidido por app, em ticks
+    }
+
+    // O workload define a quantidade de apps
+    if(workload_path){
+        if(app_fibers){
+            printf("O replay de workload (-w) já descreve as ações dos apps; não combina com -e fiber\n");
+            exit(1);
+        }
+        if(engine != ENGINE_DES){
+            printf("O replay de workload (-w) precisa do motor de eventos discretos (-e des)\n");
+            exit(1);
+        }
+        if(arrival_rate > 0){
+            printf("O replay de workload (-w) já define as chegadas; não combina com -r\n");
+            exit(1);
+        }
+        workload_open();
+    }
+
+    if(sweep_on)
+        return sweep_main();
+    if(restore_path)
+        snapshot_open(); // apps, CPUs, dispositivos e política vêm do checkpoint
+
+    // Aloca a tabela de processos e o mapa PID -> índice para a quantidade pedida
+    proc_table_init(num_procs_app);
+    pidmap_init(&pid_map, num_procs_app);
+    rng_seed(&sched_rng, sim_seed + 1);
+
+    if(engine == ENGINE_DES){
+        signal(SIGINT, sigint_handler);
+        signal(SIGUSR1, sigusr1_handler);
+        return des_main();
+    }
+
+    // Instala sinais para status/pause/retomar
+    signal(SIGINT,  sigint_handler);
+    signal(SIGUSR1, sigusr1_handler);
+    signal(SIGCONT, sigusr1_handler);
+
+    if(pipe(irq_pipe) < 0 || pipe(sys_pipe) < 0){
+        printf("Erro na criação dos pipes\n");
+        exit(1);
+    }
+
+    
+    // Colocar leitura como não bloqueante dos pipes 
+    set_nonblock(irq_pipe[0]);
+    set_nonblock(sys_pipe[0]);
+    sys_fd = sys_pipe[0];
+#ifdef __linux__
+    // Anel compartilhado: precisa existir antes dos forks para ser herdado pelos apps
+    if(transport == TRANSPORT_SHM){
+        if(shm_ring_open(num_procs_app) < 0){
+            printf("Erro na criação do anel em memória compartilhada\n");
+            exit(1);
+        }
+        sys_fd = shm_doorbell;
+    }
+#endif
+    if(suspend_mode == SUSPEND_FUTEX && permit_open(num_procs_app) < 0){
+        printf("Erro na criação das permissões de execução\n");
+        exit(1);
+    }
+    if(progress_mode == PROGRESS_SHM && pc_slots_open(num_procs_app) < 0){
+        printf("Erro na criação dos contadores de PC\n");
+        exit(1);
+    }
+
+    // Cria InterController (no modo timerfd o próprio kernel gera as IRQs)
+    if(timer_source == TIMER_IC){
+        ic_pid = fork();
+        if(ic_pid < 0){ 
+            printf("Erro na criação do InterControllerSIM\n");
+            exit(1);
+        }
+        if(ic_pid == 0){
+            intercontroller_process();
+            exit(0);
+        }
+    }
+
+    // Fecha escrita de IRQ no Kernel; quem escreve é só o IC
+    close(irq_pipe[1]);
+
+    // Trace antes dos forks, para registrar a chegada dos apps
+    if(trace_path)
+        trace_open();
+
+    // Cria as filas de pronto (uma por CPU) e as dos dispositivos
+    cpus_init();
+    devices_init();
+    if(stats_path)
+        stats_open();
+    if(arrival_rate > 0)
+        open_init();
+    long hc = sysconf(_SC_NPROCESSORS_ONLN);
+    host_cpus = hc > 0 ? hc : 1;
+
+    //Criaçao dos processos
+    for(int i=0;i<num_procs_app;i++){
+        pcb_init(i);
+
+        pid_t p = fork();
+        if(p < 0){
+            printf("Erro na criação dos processos\n");
+            exit(1);
+        }
+        if(p == 0){
+            // Os application processes começam parados, e são escalonados quando o kernel decidir
+            // Para isso: mandar SIGSTOP a si mesmo, Kernel fará SIGCONT quando escalar
+            // (com -S futex: esperar a permissão que o kernel concede ao escalar)
+            if(suspend_mode == SUSPEND_FUTEX)
+                permit_wait(i);
+            else
+                kill(getpid(), SIGSTOP);
+            app_process(i);
+            return 0;
+        }
+        // Só segue com o filho já parado: um SIGCONT que chegasse antes do SIGSTOP dele se perderia
+        if(suspend_mode == SUSPEND_SIGNAL)
+            waitpid(p, NULL, WUNTRACED);
+        // No Kernel: registra PCB e enfileira (no sistema aberto o processo fica no pool até uma chegada)
+        if(arrival_rate > 0)
+            pool_add(i, p);
+        else
+            pcb_register(i, p);
+    }
+
+    // Kernel não escreve no sys_pipe; só lê
+    close(sys_pipe[1]);
+
+    start_first();
+
+    // Origem das IRQs monitorada pelo loop
+    irq_fd = irq_pipe[0];
+#ifdef __linux__
+    if(timer_source == TIMER_TIMERFD){
+        rng_seed(&kernel_rng, sim_seed);
+        irq_fd = timer_open();
+        if(irq_fd < 0){
+            printf("Erro na criação do timerfd\n");
+            exit(1);
+        }
+    }
+#endif
+    if(io_model){
+#ifdef __linux__
+        key_heap_init(&io_inflight);
+        io_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+#endif
+        if(io_fd < 0){
+            printf("Erro na criação do timerfd dos dispositivos (-D requer Linux no modo real)\n");
+            exit(1);
+        }
+    }
+
+    // Loop principal do Kernel
+#ifdef __linux__
+    if(loop_backend == LOOP_EPOLL)
+        loop_epoll();
+    else
+#endif
+        loop_select();
+
+    // encerra qualquer resto de processo que ainda não tenha terminado
+    for(int i=bits_next(pt.alive, 0);i>=0;i=bits_next(pt.alive, i + 1)){
+        kill(pt.pid[i], SIGKILL);
+        waitpid(pt.pid[i], NULL, 0);
     }
+    if(check_on)
+        check_final();
+    trace_close();
+    stats_close();
+    print_open_stats();
+    print_adapt();
+    print_jitter();
+    print_loop_stats();
+    print_cpu_stats();
+    print_devices();
+    print_metrics();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,186 @@
+// Leitor da página de estatísticas ao vivo gravada por ./sim --stats: imprime a tabela de status
+// sem sinalizar nem parar o kernel
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // memcpy(), memcmp()
+#include <unistd.h> // usleep(), close()
+#include <signal.h> // kill(pid, 0): o kernel ainda existe?
+#include <fcntl.h> // open()
+#include <sched.h> // sched_yield()
+#include <getopt.h> // getopt_long()
+#include <sys/mman.h> // mmap()
+#include <sys/stat.h> // fstat()
+#include "stats.h"
+
+#define true 1
+#define false 0
+
+#define COPY_TRIES 1000 // tentativas de cópia consistente antes de desistir
+
+char *state_names[STATS_NUM_STATES] = { "READY", "RUNNING", "BLOCKED", "TERMINATED" };
+char *op_names[] = { "READ", "WRITE", "EXEC" };
+
+char *state_name(int s){
+    if(s >= 0 && s < STATS_NUM_STATES)
+        return state_names[s];
+    return "?";
+}
+
+char *op_name(int op){
+    if(op >= 0 && op < 3)
+        return op_names[op];
+    return "-";
+}
+
+char *dev_name(int d){
+    static char *names[] = { "D1", "D2", "D3", "D4", "D5", "D6", "D7", "D8" };
+    if(d >= 0 && d < STATS_MAX_DEVICES)
+        return names[d];
+    return "-";
+}
+
+// Copia a página para buf sob o seqlock: só aceita se seq era par e não mudou durante a cópia
+int snapshot(StatsHeader *page, size_t len, char *buf){
+    for(int t=0;t<COPY_TRIES;t++){
+        unsigned s1 = atomic_load_explicit(&page->seq, memory_order_acquire);
+        if(s1 & 1){ // o kernel está escrevendo
+            sched_yield();
+            continue;
+        }
+        memcpy(buf, page, len);
+        atomic_thread_fence(memory_order_acquire);
+        if(atomic_load_explicit(&page->seq, memory_order_relaxed) == s1)
+            return true;
+    }
+    return false;
+}
+
+void print_table(StatsHeader *h, StatsProc *procs, int summary){
+    printf("\n===== STATUS (Kernel PID = %d, %s, %.3f s, publicação %lld) =====\n", h->kernel_pid,
+           h->engine ? "tempo virtual" : "tempo real", h->t_ns / 1e9, h->publications);
+    if(!summary){
+        printf(" PID     | Name |   State   |  PC  | Blocked | Op   | R  W  X |");
+        for(int d=0;d<h->num_devices;d++)
+            printf("  %sACS  |", dev_name(d));
+        printf(" ");
+        if(h->adapt_target_ns)
+            printf(" Quantum |  Surto  | Bloq |");
+        printf("\n");
+        printf("--------------------------------------------------------------\n");
+        for(int i=0;i<h->num_procs;i++){
+            StatsProc *p = &procs[i];
+            printf(" %-7d | %-4s | %-9s | %-4d | ", p->pid, p->name, state_name(p->state), p->pc);
+            if(p->state == STATS_BLOCKED)
+                printf("%-7s | %-4s | ", dev_name(p->blocked_dev), op_name(p->blocked_op));
+            else
+                printf("%-7s | %-4s | ", "-", "-");
+            printf("%-2d %-2d %-2d", p->count_read, p->count_write, p->count_exec);
+            for(int d=0;d<h->num_devices;d++)
+                printf(" %7d  ", p->count_dev[d]);
+            if(h->adapt_target_ns)
+                printf("         %5lldms   %5lldms  %3d%%", p->quantum_ns / 1000000, p->burst_ns / 1000000, p->block_pct);
+            printf("\n");
+        }
+    }
+    int ready = 0;
+    for(int c=0;c<h->num_cpus;c++)
+        ready += h->cpu_ready[c];
+    printf(" ReadyQ size=%d (%s)", ready, h->policy);
+    for(int d=0;d<h->num_devices;d++)
+        printf(" | %sQ=%d", dev_name(d), h->dev_queue[d]);
+    printf("\n");
+    printf(" READY=%d RUNNING=%d BLOCKED=%d TERMINATED=%d | vivos=%d\n", h->state_count[STATS_READY],
+           h->state_count[STATS_RUNNING], h->state_count[STATS_BLOCKED], h->state_count[STATS_TERMINATED], h->alive);
+    if(h->adapt_target_ns)
+        printf(" Quantum adaptativo: meta %lld ms | mínimo %lld ms | %ld decisões\n", h->adapt_target_ns / 1000000,
+               h->adapt_qmin_ns / 1000000, h->adapt_decisions);
+    if(h->num_cpus > 1){
+        for(int c=0;c<h->num_cpus;c++)
+            printf(" CPU%d: atual=%d prontos=%d despachos=%ld\n", c, h->cpu_current[c], h->cpu_ready[c], h->cpu_dispatches[c]);
+    }
+    printf("================================\n");
+}
+
+void usage(char *prog){
+    printf("Uso: %s [-i SEGUNDOS] [-s] ARQUIVO\n", prog);
+    printf("  -i, --interval S  repete a cada S segundos enquanto o kernel existir\n");
+    printf("  -s, --summary     só os totais (sem uma linha por app)\n");
+}
+
+int main(int argc, char *argv[]){
+    double interval = 0;
+    int summary = false;
+    static struct option long_opts[] = {
+        {"interval", required_argument, 0, 'i'},
+        {"summary",  no_argument,       0, 's'},
+        {"help",     no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+    int c;
+    while((c = getopt_long(argc, argv, "i:sh", long_opts, NULL)) != -1){
+        switch(c){
+            case 'i':
+                interval = atof(optarg);
+                if(interval <= 0){
+                    printf("Intervalo inválido: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 's':
+                summary = true;
+                break;
+            case 'h':
+                usage(argv[0]);
+                exit(0);
+            default:
+                usage(argv[0]);
+                exit(1);
+        }
+    }
+    if(optind >= argc){
+        usage(argv[0]);
+        exit(1);
+    }
+
+    int fd = open(argv[optind], O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) < 0){
+        printf("Erro ao abrir %s\n", argv[optind]);
+        exit(1);
+    }
+    size_t len = st.st_size;
+    StatsHeader *page = len >= sizeof(StatsHeader) ? mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if(page == MAP_FAILED || memcmp(page->magic, STATS_MAGIC, sizeof(page->magic)) != 0){
+        printf("Arquivo não é uma página de estatísticas do simulador\n");
+        exit(1);
+    }
+    if(page->version != STATS_VERSION || page->rec_size != sizeof(StatsProc) ||
+       len < sizeof(StatsHeader) + (size_t)page->num_procs * sizeof(StatsProc)){
+        printf("Versão da página não suportada: %d (registro de %d bytes)\n", page->version, page->rec_size);
+        exit(1);
+    }
+    len = sizeof(StatsHeader) + (size_t)page->num_procs * sizeof(StatsProc);
+
+    char *buf = malloc(len);
+    if(buf == NULL){
+        printf("Erro na alocação da cópia\n");
+        exit(1);
+    }
+    StatsHeader *h = (StatsHeader *)buf;
+    while(1){
+        if(!snapshot(page, len, buf)){
+            printf("Não foi possível obter uma cópia consistente da página\n");
+            exit(1);
+        }
+        print_table(h, (StatsProc *)(h + 1), summary);
+        if(interval <= 0 || kill(h->kernel_pid, 0) < 0)
+            break;
+        fflush(stdout);
+        usleep((useconds_t)(interval * 1e6));
+    }
+    free(buf);
+    munmap(page, len);
+    return 0;
+}
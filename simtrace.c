@@ -0,0 +1,144 @@
+// Decodificador do trace binário gravado por ./sim --trace: imprime os eventos em texto ou CSV
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // strcmp(), memcmp()
+#include <getopt.h> // getopt_long()
+#include "trace.h"
+
+#define READ_RECS 4096 // registros lidos por fread
+
+typedef enum {
+    FMT_TEXT = 0,
+    FMT_CSV = 1
+} Format;
+
+char *dev_name(int d){
+    static char *names[] = { "D1", "D2", "D3", "D4", "D5", "D6", "D7", "D8" };
+    if(d >= 0 && d < (int)(sizeof(names) / sizeof(names[0])))
+        return names[d];
+    return "-";
+}
+
+char *op_name(int op){
+    switch(op){
+        case 0:
+            return "READ";
+        case 1:
+            return "WRITE";
+        case 2:
+            return "EXEC";
+    }
+    return "-";
+}
+
+char *event_names[TR_NUM_EVENTS] = {
+    "READY", "DISPATCH", "PREEMPT", "SYSCALL", "UNBLOCK", "TERMINATE", "STEAL", "PROGRESS", "TICK"
+};
+
+char *event_name(int type){
+    if(type >= 0 && type < TR_NUM_EVENTS)
+        return event_names[type];
+    return "?";
+}
+
+void print_text(TraceRec *r){
+    printf("[%7lld.%09lld] CPU%-2d %-9s pid=%d", r->t / 1000000000LL, r->t % 1000000000LL, r->cpu, event_name(r->type), r->pid);
+    switch(r->type){
+        case TR_SYSCALL:
+            printf(" %s em %s", op_name(r->op), dev_name(r->dev));
+            break;
+        case TR_UNBLOCK:
+            printf(" IRQ %s", dev_name(r->dev));
+            break;
+        case TR_STEAL:
+            printf(" da CPU%d", r->op);
+            break;
+        case TR_PROGRESS:
+            printf(" PC=%d", r->op);
+            break;
+    }
+    printf("\n");
+}
+
+void print_csv(TraceRec *r){
+    printf("%lld,%s,%d,%d,%d,%d\n", r->t, event_name(r->type), r->pid, r->cpu, r->dev, r->op);
+}
+
+void usage(char *prog){
+    printf("Uso: %s [-f text|csv] [ARQUIVO]\n", prog);
+    printf("  -f, --format F  saída em texto (padrão) ou CSV (t_ns,evento,pid,cpu,dev,op)\n");
+    printf("  sem ARQUIVO, lê da entrada padrão\n");
+}
+
+int main(int argc, char *argv[]){
+    Format fmt = FMT_TEXT;
+    static struct option long_opts[] = {
+        {"format", required_argument, 0, 'f'},
+        {"help",   no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+    int c;
+    while((c = getopt_long(argc, argv, "f:h", long_opts, NULL)) != -1){
+        switch(c){
+            case 'f':
+                if(strcmp(optarg, "text") == 0)
+                    fmt = FMT_TEXT;
+                else if(strcmp(optarg, "csv") == 0)
+                    fmt = FMT_CSV;
+                else {
+                    printf("Formato inválido: %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'h':
+                usage(argv[0]);
+                exit(0);
+            default:
+                usage(argv[0]);
+                exit(1);
+        }
+    }
+
+    FILE *in = stdin;
+    if(optind < argc){
+        in = fopen(argv[optind], "rb");
+        if(in == NULL){
+            printf("Erro ao abrir %s\n", argv[optind]);
+            exit(1);
+        }
+    }
+
+    TraceHeader h;
+    if(fread(&h, sizeof(h), 1, in) != 1 || memcmp(h.magic, TRACE_MAGIC, sizeof(h.magic)) != 0){
+        printf("Arquivo não é um trace do simulador\n");
+        exit(1);
+    }
+    if(h.version != TRACE_VERSION || h.rec_size != sizeof(TraceRec)){
+        printf("Versão de trace não suportada: %d (registro de %d bytes)\n", h.version, h.rec_size);
+        exit(1);
+    }
+
+    if(fmt == FMT_CSV)
+        printf("t_ns,evento,pid,cpu,dev,op\n");
+    else
+        printf("# semente %lld | %s | %d CPU(s)\n", h.seed, h.engine ? "eventos discretos (tempo virtual)" : "tempo real", h.num_cpus);
+
+    TraceRec *buf = malloc(READ_RECS * sizeof(TraceRec));
+    if(buf == NULL){
+        printf("Erro na alocação do buffer\n");
+        exit(1);
+    }
+    size_t n;
+    while((n = fread(buf, sizeof(TraceRec), READ_RECS, in)) > 0){
+        for(size_t i=0;i<n;i++){
+            if(fmt == FMT_CSV)
+                print_csv(&buf[i]);
+            else
+                print_text(&buf[i]);
+        }
+    }
+    free(buf);
+    if(in != stdin)
+        fclose(in);
+    return 0;
+}
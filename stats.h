@@ -0,0 +1,66 @@
+// Página de estatísticas ao vivo (gravada pelo sim com --stats, lida pelo simstat sem parar o kernel)
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdatomic.h>
+
+#define STATS_MAGIC "SIMSTATS"
+#define STATS_VERSION 2
+#define STATS_MAX_CPUS 64
+#define STATS_MAX_DEVICES 8
+
+// Estados do app em StatsProc.state e índices de StatsHeader.state_count (o ProcessState do sim usa estes valores)
+enum {
+    STATS_READY = 0,
+    STATS_RUNNING = 1,
+    STATS_BLOCKED = 2,
+    STATS_TERMINATED = 3,
+    STATS_NUM_STATES
+};
+
+// Seqlock: o kernel deixa seq ímpar enquanto reescreve a página e par quando termina; o leitor copia
+// a página e só aceita a cópia se seq era par e não mudou durante a leitura
+typedef struct {
+    char magic[8]; // STATS_MAGIC, sem o '\0'
+    int version; // STATS_VERSION
+    int rec_size; // sizeof(StatsProc)
+    int num_procs; // registros StatsProc depois do cabeçalho
+    int kernel_pid;
+    _Atomic unsigned seq;
+
+    // abaixo: protegido pelo seq
+    long long t_ns; // instante da publicação desde o início (virtual no modo de eventos discretos)
+    long long publications;
+    int engine; // 0 = real, 1 = eventos discretos
+    char policy[16];
+    int num_cpus;
+    int num_devices;
+    int state_count[STATS_NUM_STATES];
+    int alive;
+    int cpu_current[STATS_MAX_CPUS]; // pid em execução (-1 = ociosa)
+    int cpu_ready[STATS_MAX_CPUS];
+    long cpu_dispatches[STATS_MAX_CPUS];
+    int dev_queue[STATS_MAX_DEVICES]; // apps esperando ou em serviço
+    long long adapt_target_ns; // meta de resposta do quantum adaptativo (-A); 0 = quantum fixo
+    long long adapt_qmin_ns; // quantum mínimo atual (sobe se as trocas medidas ficarem caras)
+    long adapt_decisions; // quanta escolhidos até agora
+} StatsHeader;
+
+typedef struct {
+    int pid;
+    char name[16];
+    int state; // STATS_READY..STATS_TERMINATED
+    int pc;
+    int cpu;
+    int blocked_dev; // -1 se não bloqueado
+    int blocked_op;
+    int count_read;
+    int count_write;
+    int count_exec;
+    int count_dev[STATS_MAX_DEVICES];
+    long long quantum_ns; // quantum do último despacho (-A)
+    long long burst_ns; // média móvel dos surtos de CPU entre bloqueios (-A)
+    int block_pct; // % recente de quanta que terminaram em bloqueio (-A)
+} StatsProc;
+
+#endif
@@ -0,0 +1,135 @@
+#!/bin/sh
+# Testes de regressão (make test), com sementes fixas; tudo no motor de eventos discretos, menos o item 3:
+#  1) invariantes (-C) em todas as políticas e modos: nenhum PID em duas filas, filas coerentes com os
+#     estados e todo app chegando a TERMINATED
+#  2) equivalências: -e fiber reproduz -e des; checkpoint + restauração reproduz a execução sem parada
+#  3) modo real com -C, num binário com iterações de 100 ms: syscalls e términos que cruzam com a
+#     preempção não podem deixar um app em duas filas nem fora delas
+#  4) métricas de referência: vazão, trocas e percentis de espera/resposta/turnaround de uma varredura
+#     fixa comparados com tests/golden.csv, com tolerância relativa TOL (padrão 0.02)
+# Uso: tests/run.sh            roda os testes
+#      tests/run.sh golden     regrava tests/golden.csv (depois de uma mudança de comportamento intencional)
+set -u
+cd "$(dirname "$0")/.."
+
+SIM=./sim
+GOLDEN=tests/golden.csv
+TOL=${TOL:-0.02}
+TMP=${TMPDIR:-/tmp}/simtest.$$
+mkdir -p "$TMP"
+trap 'rm -rf "$TMP"' EXIT
+failures=0
+
+pass(){ printf '  ok     %s\n' "$1"; }
+fail(){ printf '  FALHA  %s\n' "$1"; failures=$((failures + 1)); }
+
+# Cenários da varredura de referência: nome e opções comuns a todas as configurações
+SCENARIOS='base:-n 40
+io:-n 40 -D depth=2,order=sjf,all=exp:300 -D order=deadline,all=const:100
+aberto:-n 20 -r 0.3 -d 300
+adaptativo:-n 40 -A 2000'
+
+# CSV da varredura de todos os cenários, com o cenário na frente e sem a coluna wall_s (relógio real)
+metrics_csv(){
+    echo "$SCENARIOS" | while IFS=: read -r name opts; do
+        $SIM -C -j 1 -W policy=rr,mlfq,lottery,stride,cfs,o1 -W seed=1,2,3 -W cpus=1,4 $opts 2>/dev/null |
+            awk -F, -v s="$name" 'BEGIN { OFS = "," }
+                NR == 1 { if(s == "base") { NF--; print "scenario", $0 }; next }
+                { NF--; print s, $0 }'
+    done
+}
+
+if [ "${1:-}" = "golden" ]; then
+    metrics_csv > "$GOLDEN"
+    echo "$GOLDEN regravado ($(($(wc -l < "$GOLDEN") - 1)) configurações)"
+    exit 0
+fi
+
+# O modo real leva uns 10 s em tempo real: as execuções começam já, em paralelo com os outros testes
+set -- "-n 5 -c 2 -A 200 -S futex" "-n 6 -c 3 -a 50 -A 200 -S futex -p lottery" "-n 4 -c 2 -A 200 -p cfs"
+if ${CC:-cc} -O2 -DAPP_STEP_MS=100 -o "$TMP/sim-fast" sim.c -pthread -lm; then
+    k=0
+    for opts; do
+        k=$((k + 1))
+        "$TMP/sim-fast" -q -C -s 5 $opts > "$TMP/real$k" 2>&1 &
+    done
+fi
+
+echo "== Invariantes (-C)"
+for p in rr mlfq lottery stride cfs o1; do
+    for opts in "-n 30" "-n 30 -c 4 -a 30" "-n 30 -c 3 -N 0,-5,10" "-n 10 -r 0.5 -d 300" \
+                "-n 30 -D depth=2,order=sjf,all=exp:300 -D order=deadline,all=const:100" "-n 30 -A 1500" "-n 30 -c 2 -e fiber"; do
+        if $SIM -e des -q -C -s 7 -p $p $opts > "$TMP/out" 2>&1 && grep -q 'invariantes ok' "$TMP/out"; then
+            pass "$p $opts"
+        else
+            fail "$p $opts: $(grep -m1 '\[Check\]\|Erro' "$TMP/out")"
+        fi
+    done
+done
+if $SIM -e des -q -C -w workloads/exemplo.wl > "$TMP/out" 2>&1 && grep -q 'invariantes ok' "$TMP/out"; then
+    pass "workload exemplo.wl"
+else
+    fail "workload exemplo.wl: $(grep -m1 '\[Check\]' "$TMP/out")"
+fi
+
+# Linhas que dependem do relógio real ou do modo de execução
+strip(){ grep -v 'eventos/s\|\[Fibras\]\|\[Checkpoint\]'; }
+
+echo "== Equivalências"
+for opts in "-n 50 -p rr" "-n 40 -c 4 -p cfs -a 50" "-n 20 -r 0.5 -d 600 -p o1 -N 0,5" "-n 30 -p mlfq -D all=exp:200"; do
+    $SIM -e des -q -s 3 $opts | strip > "$TMP/des"
+    $SIM -e fiber -q -s 3 $opts | strip > "$TMP/fiber"
+    if cmp -s "$TMP/des" "$TMP/fiber"; then pass "fiber = des: $opts"; else fail "fiber = des: $opts"; fi
+    $SIM -e des -q -s 3 $opts -k "$TMP/ck" -K 200 | strip > "$TMP/full"
+    $SIM -R "$TMP/ck" -q | strip > "$TMP/restored"
+    if cmp -s "$TMP/des" "$TMP/full" && cmp -s "$TMP/full" "$TMP/restored"; then
+        pass "checkpoint em 200 s + restauração: $opts"
+    else
+        fail "checkpoint em 200 s + restauração: $opts"
+    fi
+done
+
+echo "== Modo real (-C, iterações de 100 ms)"
+wait
+k=0
+for opts; do
+    k=$((k + 1))
+    if grep -q 'invariantes ok' "$TMP/real$k"; then pass "$opts"; else fail "$opts: $(grep -m1 '\[Check\]\|Erro' "$TMP/real$k")"; fi
+done
+
+echo "== Métricas de referência ($GOLDEN, tolerância $TOL)"
+metrics_csv > "$TMP/metrics.csv"
+if [ ! -f "$GOLDEN" ]; then
+    fail "$GOLDEN não existe (gere com tests/run.sh golden)"
+elif ! awk -F, -v tol="$TOL" '
+    NR == FNR { golden[FNR] = $0; n = FNR; next }
+    FNR == 1 { split($0, names); next }
+    {
+        if(!(FNR in golden)) { printf("  configuração a mais: %s\n", $0); bad++; next }
+        split(golden[FNR], g)
+        key = $1 " " $2 " seed=" $10 " cpus=" $9
+        for(i=1;i<=11;i++) # cenário, parâmetros e ok: iguais
+            if($i != g[i]) { printf("  %s: %s = %s (referência %s)\n", key, names[i], $i, g[i]); bad++ }
+        if($11 != 1) { printf("  %s: simulação falhou (invariante ou erro)\n", key); bad++ }
+        if($1 != "aberto" && $13 != $8) { printf("  %s: %s de %s apps terminaram\n", key, $13, $8); bad++ }
+        for(i=12;i<=NF;i++){ # métricas: diferença relativa até tol
+            d = $i - g[i]; if(d < 0) d = -d
+            m = g[i] < 0 ? -g[i] : g[i]
+            if(d > tol * m) { printf("  %s: %s = %s (referência %s)\n", key, names[i], $i, g[i]); bad++ }
+        }
+    }
+    END {
+        if(FNR - 1 != n - 1) { printf("  %d configurações, referência tem %d\n", FNR - 1, n - 1); bad++ }
+        exit bad > 0
+    }' "$GOLDEN" "$TMP/metrics.csv"; then
+    fail "métricas fora da tolerância"
+else
+    pass "$(($(wc -l < "$TMP/metrics.csv") - 1)) configurações dentro da tolerância"
+fi
+
+echo
+if [ "$failures" -gt 0 ]; then
+    echo "$failures teste(s) falharam"
+    exit 1
+fi
+echo "Todos os testes passaram"
@@ -0,0 +1,41 @@
+// Formato do trace binário de eventos do kernel (gravado pelo sim com --trace, lido pelo simtrace)
+#ifndef TRACE_H
+#define TRACE_H
+
+#define TRACE_MAGIC "SIMTRACE"
+#define TRACE_VERSION 1
+
+// Cabeçalho no início do arquivo
+typedef struct {
+    char magic[8]; // TRACE_MAGIC, sem o '\0'
+    int version; // TRACE_VERSION
+    int rec_size; // sizeof(TraceRec), para recusar arquivos de outra versão do registro
+    long long seed; // semente da simulação
+    int engine; // 0 = real (relógio monotônico), 1 = eventos discretos (tempo virtual)
+    int num_cpus;
+} TraceHeader;
+
+typedef enum {
+    TR_READY = 0, // app registrado e pronto pela primeira vez
+    TR_DISPATCH = 1, // app recebeu a CPU
+    TR_PREEMPT = 2, // app perdeu a CPU no fim do timeslice
+    TR_SYSCALL = 3, // app bloqueou num dispositivo (dev, op)
+    TR_UNBLOCK = 4, // IRQ do dispositivo dev desbloqueou o app
+    TR_TERMINATE = 5, // app terminou
+    TR_STEAL = 6, // cpu roubou o app da CPU op
+    TR_PROGRESS = 7, // app avançou o PC para op
+    TR_TICK = 8, // IRQ0 na cpu (pid = app em execução, -1 se ociosa)
+    TR_NUM_EVENTS
+} TraceEvent;
+
+// Registro de tamanho fixo; campos sem significado para o evento valem -1
+typedef struct {
+    long long t; // ns desde o início da simulação
+    int type; // TraceEvent
+    int pid;
+    short cpu;
+    short dev;
+    int op;
+} TraceRec;
+
+#endif
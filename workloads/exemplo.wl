@@ -0,0 +1,23 @@
+# Workload de exemplo: 3 apps, tempos em microssegundos
+# A1: chega em 0, faz CPU, lê de D1 e termina
+proc 0
+cpu 1200000
+sys D1 READ
+cpu 800000
+
+# A2: chega em 300 ms, alterna CPU e escrita em D2
+proc 300000
+cpu 500000
+sys D2 WRITE
+cpu 500000
+sys D2 WRITE
+cpu 250000
+
+# A3: chega em 2 s, só CPU
+proc 2000000
+cpu 3000000
+
+# Términos de E/S (em ordem crescente)
+irq D2 1900000
+irq D1 2500000
+irq D2 4000000